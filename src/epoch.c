@@ -0,0 +1,178 @@
+/** @file
+ * Implementacja interfejsu epoch.h.
+ *
+ * @author Maria Wysogląd
+ * @date 2022
+ */
+#include <stdlib.h>
+
+#include "epoch.h"
+
+/**
+ * Miejsce, od którego wątek szuka wolnego miejsca ogłoszenia, lub SIZE_MAX,
+ * gdy jeszcze go nie wybrano.
+ */
+static _Thread_local size_t home_slot = SIZE_MAX;
+
+/**
+ * Licznik, który rozdziela wątkom kolejne miejsca początkowe.
+ */
+static atomic_size_t next_home_slot = 0;
+
+EpochDomain * epoch_new(void) {
+    // Rozmiar bloku z aligned_alloc musi być wielokrotnością wyrównania.
+    size_t size = (sizeof(EpochDomain) + EPOCH_LINE_SIZE - 1) /
+                  EPOCH_LINE_SIZE * EPOCH_LINE_SIZE;
+    EpochDomain *domain = aligned_alloc(alignof(EpochDomain), size);
+    if (domain == NULL) {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < EPOCH_READER_SLOTS; i++) {
+        atomic_init(&domain->slots[i].epoch, 0);
+    }
+    atomic_init(&domain->epoch, 1);
+    domain->retired = NULL;
+    domain->retired_count = 0;
+    domain->retired_capacity = 0;
+    domain->threshold = EPOCH_COLLECT_THRESHOLD;
+
+    return domain;
+}
+
+/**
+ * @brief Wykonuje odłożone zwolnienie.
+ * @param[in] retired - wskaźnik na odłożone zwolnienie.
+ */
+static void release_retired(EpochRetired const *retired) {
+    if (retired->release == NULL) {
+        free(retired->item);
+    }
+    else {
+        retired->release(retired->context, retired->item);
+    }
+}
+
+void epoch_delete(EpochDomain *domain) {
+    if (domain != NULL) {
+        for (size_t i = 0; i < domain->retired_count; i++) {
+            release_retired(&domain->retired[i]);
+        }
+        free(domain->retired);
+        free(domain);
+    }
+}
+
+size_t epoch_enter(EpochDomain *domain) {
+    if (home_slot == SIZE_MAX) {
+        home_slot = atomic_fetch_add_explicit(&next_home_slot, 1,
+                                              memory_order_relaxed) %
+                    EPOCH_READER_SLOTS;
+    }
+
+    // Zajęte miejsce należy do innego odczytu, więc szukamy dalej.
+    for (size_t slot = home_slot;; slot = (slot + 1) % EPOCH_READER_SLOTS) {
+        uint64_t idle = 0;
+        uint64_t epoch = atomic_load_explicit(&domain->epoch,
+                                              memory_order_acquire);
+        if (atomic_compare_exchange_strong(&domain->slots[slot].epoch, &idle,
+                                           epoch)) {
+            /* Ogłoszenie musi być widoczne dla wątku piszącego, zanim
+            odczytamy cokolwiek ze struktury. */
+            atomic_thread_fence(memory_order_seq_cst);
+            return slot;
+        }
+    }
+}
+
+void epoch_exit(EpochDomain *domain, size_t slot) {
+    atomic_store_explicit(&domain->slots[slot].epoch, 0, memory_order_release);
+}
+
+/**
+ * @brief Przechodzi do kolejnej epoki i wyznacza najstarszy trwający odczyt.
+ * @param[in, out] domain - wskaźnik na domenę.
+ * @return Najmniejsza epoka ogłoszona przez trwający odczyt albo nowa
+ *         epoka, gdy żaden odczyt nie trwa.
+ */
+static uint64_t advance(EpochDomain *domain) {
+    uint64_t epoch = atomic_load_explicit(&domain->epoch,
+                                          memory_order_relaxed) + 1;
+    atomic_store_explicit(&domain->epoch, epoch, memory_order_release);
+    // Odpięcia obiektów muszą być widoczne, zanim przejrzymy ogłoszenia.
+    atomic_thread_fence(memory_order_seq_cst);
+
+    uint64_t oldest = epoch;
+    for (size_t i = 0; i < EPOCH_READER_SLOTS; i++) {
+        uint64_t announced = atomic_load_explicit(&domain->slots[i].epoch,
+                                                  memory_order_acquire);
+        if ((announced != 0) && (announced < oldest)) {
+            oldest = announced;
+        }
+    }
+
+    return oldest;
+}
+
+void epoch_collect(EpochDomain *domain) {
+    uint64_t oldest = advance(domain);
+
+    size_t kept = 0;
+    for (size_t i = 0; i < domain->retired_count; i++) {
+        if (domain->retired[i].epoch < oldest) {
+            release_retired(&domain->retired[i]);
+        }
+        else {
+            domain->retired[kept++] = domain->retired[i];
+        }
+    }
+    domain->retired_count = kept;
+
+    // Długie odczyty nie mogą sprawić, że każde odłożenie przegląda wszystko.
+    domain->threshold = (2 * kept > EPOCH_COLLECT_THRESHOLD) ?
+                        2 * kept : EPOCH_COLLECT_THRESHOLD;
+}
+
+void epoch_synchronize(EpochDomain *domain) {
+    advance(domain);
+
+    // Odczyty, które zaczną się teraz, ogłoszą już nową epokę.
+    uint64_t epoch = atomic_load_explicit(&domain->epoch, memory_order_relaxed);
+    for (size_t i = 0; i < EPOCH_READER_SLOTS; i++) {
+        uint64_t announced = atomic_load_explicit(&domain->slots[i].epoch,
+                                                  memory_order_acquire);
+        while ((announced != 0) && (announced < epoch)) {
+            announced = atomic_load_explicit(&domain->slots[i].epoch,
+                                             memory_order_acquire);
+        }
+    }
+}
+
+void epoch_retire(EpochDomain *domain, void (*release)(void *, void *),
+                  void *context, void *item) {
+    EpochRetired retired = {release, context, item,
+                            atomic_load_explicit(&domain->epoch,
+                                                 memory_order_relaxed)};
+
+    if (domain->retired_count == domain->retired_capacity) {
+        size_t capacity = 2 * domain->retired_capacity + EPOCH_COLLECT_THRESHOLD;
+        EpochRetired *list = realloc(domain->retired,
+                                     capacity * sizeof(EpochRetired));
+        if (list == NULL) {
+            epoch_synchronize(domain);
+            release_retired(&retired);
+            return;
+        }
+        domain->retired = list;
+        domain->retired_capacity = capacity;
+    }
+
+    domain->retired[domain->retired_count++] = retired;
+    if (domain->retired_count >= domain->threshold) {
+        epoch_collect(domain);
+    }
+}
+
+void epoch_defer_free(void *domain, void *memory) {
+    epoch_retire(domain, NULL, NULL, memory);
+}
@@ -0,0 +1,134 @@
+/** @file
+ * Interfejs odkładanego zwalniania pamięci czytanej przez wiele wątków
+ *
+ * @author Maria Wysogląd
+ * @date 2022
+ */
+
+#ifndef __EPOCH_H__
+#define __EPOCH_H__
+
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define EPOCH_READER_SLOTS 64 ///< Liczba wątków, które mogą naraz czytać strukturę bez czekania.
+#define EPOCH_COLLECT_THRESHOLD 64 ///< Najmniejsza liczba odłożonych zwolnień, po której próbujemy je wykonać.
+#define EPOCH_LINE_SIZE 64 ///< Rozmiar wiersza pamięci podręcznej procesora.
+
+/**
+ * @brief To jest miejsce ogłoszenia wątku czytającego.
+ * Zajmuje cały wiersz pamięci podręcznej procesora, więc wątki czytające
+ * z różnych miejsc nie unieważniają sobie nawzajem pamięci podręcznej.
+ */
+struct EpochSlot {
+    alignas(EPOCH_LINE_SIZE) _Atomic uint64_t epoch; ///< Epoka, w której wątek zaczął czytać, lub 0, gdy miejsce jest wolne.
+};
+/**
+ * Tworzy typ EpochSlot.
+ */
+typedef struct EpochSlot EpochSlot;
+
+/**
+ * @brief To jest odłożone zwolnienie pamięci.
+ */
+struct EpochRetired {
+    void (*release)(void *context, void *item); ///< Funkcja zwalniająca lub NULL, gdy wystarczy free.
+    void *context; ///< Pierwszy argument funkcji zwalniającej.
+    void *item; ///< Zwalniany obiekt.
+    uint64_t epoch; ///< Epoka, w której obiekt odłożono.
+};
+/**
+ * Tworzy typ EpochRetired.
+ */
+typedef struct EpochRetired EpochRetired;
+
+/**
+ * @brief To jest domena epok.
+ * Wątek czytający ogłasza na czas odczytu bieżącą epokę w wolnym miejscu
+ * domeny. Jedyny wątek piszący nie zwalnia od razu pamięci, którą odczyt
+ * mógł już zobaczyć, tylko odkłada ją z numerem bieżącej epoki. Obiekt
+ * odłożony w epoce e zwalnia dopiero wtedy, gdy po przejściu do kolejnej
+ * epoki żaden trwający odczyt nie ogłosił epoki mniejszej lub równej e:
+ * późniejsze odczyty zaczęły się już po odpięciu obiektu od struktury.
+ * Wątki czytające niczego nie blokują i na nic nie czekają, dopóki jest
+ * ich najwyżej EPOCH_READER_SLOTS naraz.
+ */
+struct EpochDomain {
+    EpochSlot slots[EPOCH_READER_SLOTS]; ///< Miejsca ogłoszeń wątków czytających.
+    alignas(EPOCH_LINE_SIZE) _Atomic uint64_t epoch; ///< Bieżąca epoka, zaczyna się od 1.
+    EpochRetired *retired; ///< Odłożone zwolnienia w kolejności odkładania.
+    size_t retired_count; ///< Liczba odłożonych zwolnień.
+    size_t retired_capacity; ///< Rozmiar tablicy odłożonych zwolnień.
+    size_t threshold; ///< Liczba odłożonych zwolnień, po której wywołujemy epoch_collect.
+};
+/**
+ * Tworzy typ EpochDomain.
+ */
+typedef struct EpochDomain EpochDomain;
+
+/** @brief Tworzy domenę epok.
+ * @return Wskaźnik na domenę lub NULL, gdy nie udało się alokować pamięci.
+ */
+EpochDomain * epoch_new(void);
+
+/** @brief Usuwa domenę epok.
+ * Wykonuje wszystkie odłożone zwolnienia, więc żaden wątek nie może wtedy
+ * czytać chronionej struktury. Nic nie robi, jeśli @p domain ma wartość
+ * NULL.
+ * @param[in, out] domain – wskaźnik na domenę.
+ */
+void epoch_delete(EpochDomain *domain);
+
+/** @brief Zaczyna odczyt.
+ * Do wywołania @ref epoch_exit nie zostanie zwolniona pamięć, którą wątek
+ * może zobaczyć w strukturze. Odczyty mogą się zagnieżdżać.
+ * @param[in, out] domain – wskaźnik na domenę.
+ * @return Numer miejsca zajętego przez odczyt.
+ */
+size_t epoch_enter(EpochDomain *domain);
+
+/** @brief Kończy odczyt.
+ * @param[in, out] domain – wskaźnik na domenę;
+ * @param[in] slot        – numer zwrócony przez @ref epoch_enter.
+ */
+void epoch_exit(EpochDomain *domain, size_t slot);
+
+/** @brief Odkłada zwolnienie obiektu odpiętego od struktury.
+ * Obiekt zostanie zwolniony, gdy skończą się wszystkie odczyty, które mogły
+ * go zobaczyć. Co jakiś czas wywołuje przy tym @ref epoch_collect. Jeśli nie
+ * uda się alokować miejsca na odłożenie, czeka na koniec trwających odczytów
+ * i zwalnia obiekt od razu. Wywołuje ją tylko wątek piszący.
+ * @param[in, out] domain – wskaźnik na domenę;
+ * @param[in] release     – funkcja zwalniająca lub NULL, gdy wystarczy free;
+ * @param[in] context     – pierwszy argument funkcji zwalniającej;
+ * @param[in] item        – zwalniany obiekt, drugi argument funkcji
+ *                          zwalniającej.
+ */
+void epoch_retire(EpochDomain *domain, void (*release)(void *, void *),
+                  void *context, void *item);
+
+/** @brief Odkłada zwolnienie pamięci funkcją free.
+ * Ma postać funkcji odkładającej zwolnienia w pulach węzłów i napisów.
+ * @param[in, out] domain – wskaźnik na domenę EpochDomain;
+ * @param[in] memory      – zwalniana pamięć.
+ */
+void epoch_defer_free(void *domain, void *memory);
+
+/** @brief Wykonuje odłożone zwolnienia, na które już pora.
+ * Przechodzi do kolejnej epoki i zwalnia obiekty, których nie może już
+ * czytać żaden trwający odczyt. Wywołuje ją tylko wątek piszący.
+ * @param[in, out] domain – wskaźnik na domenę.
+ */
+void epoch_collect(EpochDomain *domain);
+
+/** @brief Czeka, aż skończą się wszystkie trwające odczyty.
+ * Odczyty, które zaczną się w trakcie czekania, nie przedłużają go. Po
+ * powrocie żaden odczyt nie widzi już obiektów odpiętych przed wywołaniem,
+ * więc można je zwolnić od razu.
+ * @param[in, out] domain – wskaźnik na domenę.
+ */
+void epoch_synchronize(EpochDomain *domain);
+
+#endif /* __EPOCH_H__ */
@@ -0,0 +1,210 @@
+/** @file
+ * Implementacja interfejsu node_pool.h.
+ *
+ * @author Maria Wysogląd
+ * @date 2022
+ */
+#include <stdalign.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "node_pool.h"
+
+void node_pool_init(NodePool *pool, size_t node_size) {
+    // Węzeł musi pomieścić wskaźnik listy wolnych i zachować wyrównanie.
+    if (node_size < sizeof(void*)) {
+        node_size = sizeof(void*);
+    }
+    size_t align = alignof(max_align_t);
+    pool->node_size = (node_size + align - 1) / align * align;
+    pool->slabs = NULL;
+    pool->slab_count = 0;
+    pool->slab_capacity = 0;
+    pool->used_in_last = NODE_POOL_SLAB_SIZE;
+    pool->free_list = NODE_NULL;
+    pool->retire = NULL;
+    pool->retire_context = NULL;
+}
+
+/**
+ * @brief Zastępuje tablicę bloków większą.
+ * @param[in, out] pool - wskaźnik na pulę;
+ * @param[in] capacity - nowy rozmiar tablicy bloków, większy od obecnego.
+ * @return Wartość @p true, jeśli udało się alokować pamięć.
+ */
+static bool grow_slabs(NodePool *pool, size_t capacity) {
+#ifdef PHFWD_CONCURRENT
+    char **slabs = malloc(capacity * sizeof(char*));
+    if (slabs == NULL) {
+        return false;
+    }
+    if (pool->slab_count > 0) {
+        memcpy(slabs, pool->slabs, pool->slab_count * sizeof(char*));
+    }
+    char **old = pool->slabs;
+    __atomic_store_n(&pool->slabs, slabs, __ATOMIC_RELEASE);
+    if ((pool->retire != NULL) && (old != NULL)) {
+        pool->retire(pool->retire_context, old);
+    }
+    else {
+        free(old);
+    }
+#else
+    char **slabs = realloc(pool->slabs, capacity * sizeof(char*));
+    if (slabs == NULL) {
+        return false;
+    }
+    pool->slabs = slabs;
+#endif
+    pool->slab_capacity = capacity;
+
+    return true;
+}
+
+/**
+ * @brief Dokłada do puli nowy blok.
+ * @param[in, out] pool - wskaźnik na pulę.
+ * @return Wartość @p true, jeśli udało się alokować blok.
+ */
+static bool add_slab(NodePool *pool) {
+    if ((pool->slab_count == pool->slab_capacity) &&
+        !grow_slabs(pool, (pool->slab_capacity == 0) ?
+                          8 : 2 * pool->slab_capacity)) {
+        return false;
+    }
+
+#ifdef PHFWD_INDEX_NODES
+    if (pool->slab_count == (UINT32_MAX >> NODE_POOL_SLAB_BITS) + 1) {
+        return false;
+    }
+#endif
+
+    char *slab = malloc(NODE_POOL_SLAB_SIZE * pool->node_size);
+    if (slab == NULL) {
+        return false;
+    }
+    pool->slabs[pool->slab_count++] = slab;
+#ifdef PHFWD_INDEX_NODES
+    // Pierwszy węzeł pierwszego bloku ma numer 0, którego nie wydajemy.
+    pool->used_in_last = (pool->slab_count == 1) ? 1 : 0;
+#else
+    pool->used_in_last = 0;
+#endif
+
+    return true;
+}
+
+NodeRef node_pool_alloc(NodePool *pool) {
+    if (pool->free_list != NODE_NULL) {
+        NodeRef node = pool->free_list;
+        pool->free_list = *(NodeRef*)node_pool_get(pool, node);
+        return node;
+    }
+
+    if ((pool->used_in_last == NODE_POOL_SLAB_SIZE) && !add_slab(pool)) {
+        return NODE_NULL;
+    }
+
+    size_t slot = pool->used_in_last++;
+#ifdef PHFWD_INDEX_NODES
+    return (NodeRef)(((pool->slab_count - 1) << NODE_POOL_SLAB_BITS) | slot);
+#else
+    return pool->slabs[pool->slab_count - 1] + slot * pool->node_size;
+#endif
+}
+
+void node_pool_free(NodePool *pool, NodeRef node) {
+    if (node != NODE_NULL) {
+        *(NodeRef*)node_pool_get(pool, node) = pool->free_list;
+        pool->free_list = node;
+    }
+}
+
+bool node_pool_reserve(NodePool *pool, size_t slabs) {
+#ifdef PHFWD_INDEX_NODES
+    if (slabs > (UINT32_MAX >> NODE_POOL_SLAB_BITS) + 1 - pool->slab_count) {
+        return false;
+    }
+#endif
+    size_t needed = pool->slab_count + slabs;
+    if (needed <= pool->slab_capacity) {
+        return true;
+    }
+
+    size_t capacity = (pool->slab_capacity == 0) ? 8 : pool->slab_capacity;
+    while (capacity < needed) {
+        capacity *= 2;
+    }
+    return grow_slabs(pool, capacity);
+}
+
+/**
+ * @brief Oddaje na listę wolnych miejsce bloku, którego nigdy nie wydano.
+ * Zeruje je, więc funkcja zwalniająca z node_pool_destroy widzi pusty węzeł.
+ * @param[in, out] pool - wskaźnik na pulę;
+ * @param[in] slab - numer bloku;
+ * @param[in] slot - numer miejsca w bloku.
+ */
+static void free_unused(NodePool *pool, size_t slab, size_t slot) {
+    char *node = pool->slabs[slab] + slot * pool->node_size;
+    memset(node, 0, pool->node_size);
+#ifdef PHFWD_INDEX_NODES
+    node_pool_free(pool, (NodeRef)((slab << NODE_POOL_SLAB_BITS) | slot));
+#else
+    node_pool_free(pool, node);
+#endif
+}
+
+size_t node_pool_adopt(NodePool *pool, NodePool *part) {
+    size_t base = pool->slab_count;
+    if (part->slab_count > 0) {
+        // Ostatni blok puli przestaje być ostatnim, więc oddajemy jego resztę.
+        while ((base > 0) && (pool->used_in_last < NODE_POOL_SLAB_SIZE)) {
+            free_unused(pool, base - 1, pool->used_in_last++);
+        }
+        for (size_t i = 0; i < part->slab_count; i++) {
+            pool->slabs[pool->slab_count++] = part->slabs[i];
+        }
+        pool->used_in_last = part->used_in_last;
+#ifdef PHFWD_INDEX_NODES
+        // Niewydany węzeł 0 puli part ma teraz zwykły numer.
+        if (base > 0) {
+            free_unused(pool, base, 0);
+        }
+#endif
+    }
+
+    // Odnośniki listy wolnych węzłów part mają jeszcze stare numery.
+    NodeRef node = part->free_list;
+    while (node != NODE_NULL) {
+        NodeRef moved = node_pool_rebase(node, base);
+        node = *(NodeRef*)node_pool_get(pool, moved);
+        node_pool_free(pool, moved);
+    }
+
+    free(part->slabs);
+    node_pool_init(part, part->node_size);
+    return base;
+}
+
+void node_pool_destroy(NodePool *pool, void (*release)(void *node)) {
+    for (size_t i = 0; i < pool->slab_count; i++) {
+        if (release != NULL) {
+            size_t used = (i + 1 == pool->slab_count) ?
+                          pool->used_in_last : NODE_POOL_SLAB_SIZE;
+            size_t first = 0;
+#ifdef PHFWD_INDEX_NODES
+            // Pomijamy niewydawany węzeł o numerze 0.
+            first = (i == 0) ? 1 : 0;
+#endif
+            for (size_t j = first; j < used; j++) {
+                release(pool->slabs[i] + j * pool->node_size);
+            }
+        }
+        free(pool->slabs[i]);
+    }
+
+    free(pool->slabs);
+    node_pool_init(pool, pool->node_size);
+}
@@ -0,0 +1,154 @@
+/** @file
+ * Interfejs puli węzłów drzew alokowanych blokami
+ *
+ * @author Maria Wysogląd
+ * @date 2022
+ */
+
+#ifndef __NODE_POOL_H__
+#define __NODE_POOL_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define NODE_POOL_SLAB_BITS 10 ///< Logarytm liczby węzłów mieszczących się w jednym bloku.
+#define NODE_POOL_SLAB_SIZE (1u << NODE_POOL_SLAB_BITS) ///< Liczba węzłów mieszczących się w jednym bloku.
+
+#ifdef PHFWD_INDEX_NODES
+/**
+ * Odnośnik do węzła: 32-bitowy numer węzła w puli. Numer 0 jest zarezerwowany
+ * i nie odpowiada żadnemu węzłowi.
+ */
+typedef uint32_t NodeRef;
+#define NODE_NULL ((NodeRef)0) ///< Pusty odnośnik.
+#else
+/**
+ * Odnośnik do węzła: zwykły wskaźnik.
+ */
+typedef void *NodeRef;
+#define NODE_NULL NULL ///< Pusty odnośnik.
+#endif
+
+/**
+ * @brief To jest struktura puli węzłów jednego rozmiaru.
+ * Węzły są wydawane kolejno z bloków po NODE_POOL_SLAB_SIZE węzłów.
+ * Zwolnione węzły trafiają na listę wolnych i są wydawane ponownie przed
+ * sięgnięciem po nowe miejsce. Odnośnik do następnego wolnego węzła jest
+ * zapisywany na początku zwolnionego węzła.
+ * W wariancie PHFWD_INDEX_NODES węzły są identyfikowane numerami: górne bity
+ * numeru wskazują blok, a dolne NODE_POOL_SLAB_BITS bitów miejsce w bloku.
+ * Węzły odwołują się wtedy do siebie numerami, więc nie zależą od adresów
+ * bloków w pamięci. W wariancie PHFWD_CONCURRENT tablica bloków nie jest
+ * przenoszona, bo węzły mogą w tym czasie odczytywać inne wątki: pula
+ * zastępuje ją większą kopią, a zwolnienie starej oddaje funkcji @p retire.
+ */
+struct NodePool {
+    size_t node_size; ///< Rozmiar jednego węzła w bajtach.
+    char **slabs; ///< Tablica zaalokowanych bloków.
+    size_t slab_count; ///< Liczba zaalokowanych bloków.
+    size_t slab_capacity; ///< Rozmiar tablicy bloków.
+    size_t used_in_last; ///< Liczba węzłów wydanych z ostatniego bloku.
+    NodeRef free_list; ///< Lista węzłów zwolnionych.
+    void (*retire)(void *context, void *memory); ///< Funkcja odkładająca zwolnienie starej tablicy bloków lub NULL, gdy zwalniamy ją od razu.
+    void *retire_context; ///< Pierwszy argument funkcji @p retire.
+};
+/**
+ * Tworzy typ NodePool.
+ */
+typedef struct NodePool NodePool;
+
+/** @brief Inicjalizuje pustą pulę.
+ * Nie alokuje pamięci, pierwszy blok powstaje przy pierwszej alokacji węzła.
+ * @param[out] pool    – wskaźnik na inicjalizowaną pulę;
+ * @param[in] node_size – rozmiar jednego węzła w bajtach.
+ */
+void node_pool_init(NodePool *pool, size_t node_size);
+
+/** @brief Wydaje węzeł z puli.
+ * Zawartość wydanego węzła jest nieokreślona.
+ * @param[in, out] pool – wskaźnik na pulę.
+ * @return Odnośnik do węzła lub NODE_NULL, gdy nie udało się alokować pamięci.
+ */
+NodeRef node_pool_alloc(NodePool *pool);
+
+/** @brief Zwraca węzeł do puli.
+ * Nadpisuje początek węzła odnośnikiem listy wolnych węzłów. Pola, które
+ * trzymają pamięć zaalokowaną poza pulą, nie mogą leżeć na początku węzła
+ * i przed zwolnieniem powinny zostać wyzerowane.
+ * @param[in, out] pool – wskaźnik na pulę;
+ * @param[in] node      – odnośnik do zwalnianego węzła.
+ */
+void node_pool_free(NodePool *pool, NodeRef node);
+
+/** @brief Udostępnia węzeł o danym odnośniku.
+ * @param[in] pool – wskaźnik na pulę;
+ * @param[in] node – odnośnik do węzła różny od NODE_NULL.
+ * @return Wskaźnik na węzeł, ważny do usunięcia puli.
+ */
+static inline void * node_pool_get(NodePool const *pool, NodeRef node) {
+#ifdef PHFWD_INDEX_NODES
+#ifdef PHFWD_CONCURRENT
+    // Tablicę bloków może w tym czasie zastępować wątek piszący.
+    char **slabs = __atomic_load_n(&pool->slabs, __ATOMIC_ACQUIRE);
+#else
+    char **slabs = pool->slabs;
+#endif
+    return slabs[node >> NODE_POOL_SLAB_BITS] +
+           (node & (NODE_POOL_SLAB_SIZE - 1)) * pool->node_size;
+#else
+    (void)pool;
+    return node;
+#endif
+}
+
+/** @brief Rezerwuje miejsce na bloki.
+ * Powiększa tablicę bloków tak, aby @ref node_pool_adopt mogła dołączyć
+ * @p slabs bloków bez alokowania pamięci.
+ * @param[in, out] pool – wskaźnik na pulę;
+ * @param[in] slabs     – liczba dołączanych bloków.
+ * @return Wartość @p false, gdy nie udało się alokować pamięci lub
+ *         w wariancie PHFWD_INDEX_NODES zabrakłoby numerów węzłów.
+ */
+bool node_pool_reserve(NodePool *pool, size_t slabs);
+
+/** @brief Przenosi do puli wszystkie węzły innej puli.
+ * Dołącza bloki puli @p part na koniec tablicy bloków @p pool, a jej wolne
+ * węzły do listy wolnych @p pool. Niewydane miejsca ostatniego bloku
+ * @p pool trafiają wyzerowane na listę wolnych. Pula @p part zostaje pusta.
+ * Węzły się nie przesuwają, ale w wariancie PHFWD_INDEX_NODES zmieniają się
+ * ich numery: nowy numer wyznacza @ref node_pool_rebase. Odnośniki zapisane
+ * w węzłach trzeba przenumerować samemu. Pule mają ten sam rozmiar węzła,
+ * a w @p pool jest miejsce zarezerwowane funkcją @ref node_pool_reserve.
+ * @param[in, out] pool – wskaźnik na pulę;
+ * @param[in, out] part – wskaźnik na przenoszoną pulę.
+ * @return Numer pierwszego przeniesionego bloku w @p pool.
+ */
+size_t node_pool_adopt(NodePool *pool, NodePool *part);
+
+/** @brief Wyznacza odnośnik węzła przeniesionego do innej puli.
+ * @param[in] node – odnośnik do węzła w puli przeniesionej funkcją
+ *                   @ref node_pool_adopt lub NODE_NULL;
+ * @param[in] base – wynik @ref node_pool_adopt.
+ * @return Odnośnik do tego samego węzła w puli, do której go przeniesiono.
+ */
+static inline NodeRef node_pool_rebase(NodeRef node, size_t base) {
+#ifdef PHFWD_INDEX_NODES
+    return (node == NODE_NULL) ?
+           NODE_NULL : node + (NodeRef)(base << NODE_POOL_SLAB_BITS);
+#else
+    (void)base;
+    return node;
+#endif
+}
+
+/** @brief Zwalnia całą pulę.
+ * Jeśli @p release nie jest równe NULL, wywołuje je kolejno dla każdego
+ * węzła, który został kiedykolwiek wydany (również już zwolnionego), a potem
+ * zwalnia bloki, nie przechodząc po strukturze drzewa.
+ * @param[in, out] pool – wskaźnik na pulę;
+ * @param[in] release   – funkcja zwalniająca pamięć trzymaną przez węzeł.
+ */
+void node_pool_destroy(NodePool *pool, void (*release)(void *node));
+
+#endif /* __NODE_POOL_H__ */
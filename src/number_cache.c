@@ -0,0 +1,183 @@
+/** @file
+ * Implementacja interfejsu number_cache.h.
+ *
+ * @author Maria Wysogląd
+ * @date 2022
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "number_cache.h"
+
+/**
+ * @brief Wyznacza skrót numeru (FNV-1a).
+ * @param[in] num - wskaźnik na numer;
+ * @param[in] length - długość numeru.
+ * @return Skrót numeru.
+ */
+static size_t number_hash(char const *num, size_t length) {
+    uint64_t hash = 14695981039346656037u;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (unsigned char)num[i]) * 1099511628211u;
+    }
+
+    return (size_t)hash;
+}
+
+/**
+ * @brief Szuka miejsca wyniku w tablicy mieszającej.
+ * @param[in] cache - wskaźnik na pamięć podręczną;
+ * @param[in] num - wskaźnik na numer;
+ * @param[in] length - długość numeru;
+ * @param[in] hash - skrót numeru.
+ * @return Indeks miejsca z wynikiem numeru albo wolnego miejsca, w którym
+ *         wynik powinien się znaleźć.
+ */
+static size_t find_slot(NumberCache const *cache, char const *num,
+                        size_t length, size_t hash) {
+    size_t mask = cache->slot_count - 1;
+    size_t i = hash & mask;
+    while (cache->slots[i] != 0) {
+        NumberCacheEntry const *entry = &cache->entries[cache->slots[i] - 1];
+        if ((entry->hash == hash) && (entry->length == length) &&
+            (memcmp(entry->key, num, length) == 0)) {
+            break;
+        }
+        i = (i + 1) & mask;
+    }
+
+    return i;
+}
+
+/**
+ * @brief Usuwa wynik z pamięci.
+ * @param[in, out] cache - wskaźnik na pamięć podręczną;
+ * @param[in] index - numer usuwanego wyniku, którego miejsce jest zajęte.
+ */
+static void remove_entry(NumberCache *cache, size_t index) {
+    NumberCacheEntry *entry = &cache->entries[index];
+    size_t mask = cache->slot_count - 1;
+    size_t i = entry->hash & mask;
+    while (cache->slots[i] != index + 1) {
+        i = (i + 1) & mask;
+    }
+
+    // Usuwamy bez znaczników, tak jak w puli napisów.
+    size_t j = i;
+    while (true) {
+        j = (j + 1) & mask;
+        if (cache->slots[j] == 0) {
+            break;
+        }
+        size_t home = cache->entries[cache->slots[j] - 1].hash & mask;
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            cache->slots[i] = cache->slots[j];
+            i = j;
+        }
+    }
+    cache->slots[i] = 0;
+
+    entry->length = 0;
+    entry->referenced = false;
+}
+
+NumberCache * number_cache_new(size_t capacity) {
+    if ((capacity == 0) || (capacity >= (1u << 31))) {
+        return NULL;
+    }
+
+    NumberCache *cache = malloc(sizeof(NumberCache));
+    if (cache == NULL) {
+        return NULL;
+    }
+
+    // Trzymamy zapełnienie tablicy mieszającej najwyżej na poziomie 1/2.
+    size_t slot_count = 1;
+    while (slot_count < 2 * capacity) {
+        slot_count *= 2;
+    }
+
+    cache->entries = calloc(capacity, sizeof(NumberCacheEntry));
+    cache->slots = calloc(slot_count, sizeof(uint32_t));
+    cache->capacity = capacity;
+    cache->slot_count = slot_count;
+    cache->hand = 0;
+    cache->hits = 0;
+    cache->misses = 0;
+    if ((cache->entries == NULL) || (cache->slots == NULL)) {
+        number_cache_delete(cache);
+        return NULL;
+    }
+
+    return cache;
+}
+
+void number_cache_delete(NumberCache *cache) {
+    if (cache != NULL) {
+        free(cache->entries);
+        free(cache->slots);
+        free(cache);
+    }
+}
+
+bool number_cache_find(NumberCache *cache, char const *num, size_t length,
+                       InternedString const **prefix, size_t *matched) {
+    if ((length == 0) || (length > NUMBER_CACHE_KEY_CAPACITY)) {
+        cache->misses++;
+        return false;
+    }
+
+    size_t i = find_slot(cache, num, length, number_hash(num, length));
+    if (cache->slots[i] == 0) {
+        cache->misses++;
+        return false;
+    }
+
+    NumberCacheEntry *entry = &cache->entries[cache->slots[i] - 1];
+    entry->referenced = true;
+    *prefix = entry->prefix;
+    *matched = entry->matched;
+    cache->hits++;
+
+    return true;
+}
+
+void number_cache_insert(NumberCache *cache, char const *num, size_t length,
+                         InternedString const *prefix, size_t matched) {
+    if ((length == 0) || (length > NUMBER_CACHE_KEY_CAPACITY)) {
+        return;
+    }
+
+    // Wskazówka daje drugą szansę wynikom, z których ostatnio korzystano.
+    while (cache->entries[cache->hand].referenced) {
+        cache->entries[cache->hand].referenced = false;
+        cache->hand = (cache->hand + 1) % cache->capacity;
+    }
+
+    size_t index = cache->hand;
+    cache->hand = (cache->hand + 1) % cache->capacity;
+    NumberCacheEntry *entry = &cache->entries[index];
+    if (entry->length != 0) {
+        remove_entry(cache, index);
+    }
+
+    entry->prefix = prefix;
+    entry->hash = number_hash(num, length);
+    entry->length = (unsigned char)length;
+    entry->matched = (unsigned char)matched;
+    memcpy(entry->key, num, length);
+
+    cache->slots[find_slot(cache, num, length, entry->hash)] =
+        (uint32_t)(index + 1);
+}
+
+void number_cache_invalidate(NumberCache *cache, char const *num,
+                             size_t length) {
+    for (size_t i = 0; i < cache->capacity; i++) {
+        NumberCacheEntry const *entry = &cache->entries[i];
+        if ((entry->length >= length) && (entry->length != 0) &&
+            (memcmp(entry->key, num, length) == 0)) {
+            remove_entry(cache, i);
+        }
+    }
+}
@@ -0,0 +1,109 @@
+/** @file
+ * Interfejs pamięci podręcznej przekierowań często sprawdzanych numerów
+ *
+ * @author Maria Wysogląd
+ * @date 2022
+ */
+
+#ifndef __NUMBER_CACHE_H__
+#define __NUMBER_CACHE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "string_pool.h"
+
+#define NUMBER_CACHE_KEY_CAPACITY 24 ///< Największa długość zapamiętywanego numeru.
+
+/**
+ * @brief To jest zapamiętany wynik wyszukiwania numeru.
+ * Zamiast gotowego wyniku przechowuje numer, na który przekierowano
+ * najdłuższy pasujący prefiks, i długość tego prefiksu. Wynik trzeba więc
+ * jeszcze złożyć z numeru, ale nie trzeba przechodzić drzewa.
+ */
+struct NumberCacheEntry {
+    InternedString const *prefix; ///< Numer, na który przekierowano prefiks, lub NULL.
+    size_t hash; ///< Skrót numeru.
+    unsigned char length; ///< Długość numeru lub 0, gdy miejsce jest wolne.
+    unsigned char matched; ///< Długość przekierowanego prefiksu numeru.
+    bool referenced; ///< Czy z wyniku korzystano od ostatniego obiegu wskazówki.
+    char key[NUMBER_CACHE_KEY_CAPACITY]; ///< Cyfry numeru.
+};
+/**
+ * Tworzy typ NumberCacheEntry.
+ */
+typedef struct NumberCacheEntry NumberCacheEntry;
+
+/**
+ * @brief To jest ograniczona pamięć podręczna wyników wyszukiwania.
+ * Wyniki są trzymane w tablicy o stałym rozmiarze i usuwane algorytmem
+ * zegarowym (CLOCK): wskazówka omija i zeruje wyniki, z których ostatnio
+ * korzystano, a usuwa pierwszy, z którego nie korzystano. Numery są
+ * odnajdywane przez tablicę mieszającą z liniowym próbkowaniem, której
+ * miejsca przechowują numer wyniku powiększony o jeden.
+ */
+struct NumberCache {
+    NumberCacheEntry *entries; ///< Tablica wyników.
+    size_t capacity; ///< Rozmiar tablicy wyników.
+    size_t hand; ///< Pozycja wskazówki zegara.
+    uint32_t *slots; ///< Tablica mieszająca, 0 oznacza wolne miejsce.
+    size_t slot_count; ///< Rozmiar tablicy mieszającej, potęga dwójki.
+    size_t hits; ///< Liczba wyszukiwań, których wynik był zapamiętany.
+    size_t misses; ///< Liczba wyszukiwań, których wyniku nie było.
+};
+/**
+ * Tworzy typ NumberCache.
+ */
+typedef struct NumberCache NumberCache;
+
+/** @brief Tworzy pustą pamięć podręczną.
+ * @param[in] capacity – największa liczba zapamiętanych wyników, dodatnia
+ *                       i mniejsza od 2^31.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
+ *         alokować pamięci lub rozmiar jest niepoprawny.
+ */
+NumberCache * number_cache_new(size_t capacity);
+
+/** @brief Usuwa pamięć podręczną.
+ * Nic nie robi, jeśli @p cache ma wartość NULL.
+ * @param[in] cache – wskaźnik na usuwaną strukturę.
+ */
+void number_cache_delete(NumberCache *cache);
+
+/** @brief Szuka zapamiętanego wyniku.
+ * Zlicza trafienia i chybienia. Numery dłuższe niż NUMBER_CACHE_KEY_CAPACITY
+ * nie są zapamiętywane, więc zawsze chybiają.
+ * @param[in, out] cache – wskaźnik na pamięć podręczną;
+ * @param[in] num        – wskaźnik na numer;
+ * @param[in] length     – długość numeru;
+ * @param[out] prefix    – numer, na który przekierowano prefiks, lub NULL;
+ * @param[out] matched   – długość przekierowanego prefiksu.
+ * @return Wartość @p true, jeśli wynik był zapamiętany.
+ */
+bool number_cache_find(NumberCache *cache, char const *num, size_t length,
+                       InternedString const **prefix, size_t *matched);
+
+/** @brief Zapamiętuje wynik wyszukiwania.
+ * Jeśli pamięć jest pełna, usuwa z niej wynik wybrany przez wskazówkę zegara.
+ * Numery dłuższe niż NUMBER_CACHE_KEY_CAPACITY są pomijane.
+ * @param[in, out] cache – wskaźnik na pamięć podręczną;
+ * @param[in] num        – wskaźnik na poprawny numer, którego nie ma
+ *                         w pamięci;
+ * @param[in] length     – dodatnia długość numeru;
+ * @param[in] prefix     – numer, na który przekierowano prefiks, lub NULL;
+ * @param[in] matched    – długość przekierowanego prefiksu.
+ */
+void number_cache_insert(NumberCache *cache, char const *num, size_t length,
+                         InternedString const *prefix, size_t matched);
+
+/** @brief Usuwa wyniki numerów o danym prefiksie.
+ * Pozostałe wyniki zostają w pamięci.
+ * @param[in, out] cache – wskaźnik na pamięć podręczną;
+ * @param[in] num        – wskaźnik na prefiks;
+ * @param[in] length     – długość prefiksu.
+ */
+void number_cache_invalidate(NumberCache *cache, char const *num,
+                             size_t length);
+
+#endif /* __NUMBER_CACHE_H__ */
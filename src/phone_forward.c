@@ -4,12 +4,21 @@
 * @author Maria Wysogląd
 * @date 2022
 */
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
+#include <threads.h>
 
 #include "phone_forward.h"
+#include "node_pool.h"
+#include "number_cache.h"
+#include "string_pool.h"
+#ifdef PHFWD_CONCURRENT
+#include "epoch.h"
+#endif
 
 #define CORRECT 0 ///< Arbitralnie wybrana stała przekazująca informację o poprawności.
 #define ERROR 1 ///< Arbitralnie wybrana stała przekazująca informację o niepoprawności.
@@ -17,6 +26,35 @@
 #define ALPHABET_SIZE 12 ///< Cyfr od 0 do 9 jest 10, -plus cyfry 10 i 11 reprezentowane jako * i #.
 #define TEN '*' ///< Stała odpowiadająca znakowi '*' = 10.
 #define ELEVEN '#' ///< Stała odpowiadająca znakowi '#' = 11.
+#define LABEL_CAPACITY 16 ///< Maksymalna liczba cyfr zapisanych na jednej krawędzi drzewa przekierowań.
+#define BATCH_GROUP 8 ///< Liczba wyszukiwań prowadzonych naraz przez phfwdGetBatch.
+#define REVERSE_KEY_DIGITS 16 ///< Liczba początkowych cyfr numeru zapisanych w kluczu kursora.
+#define NUL_TERMINATED SIZE_MAX ///< Długość przekazywana dla numeru zakończonego znakiem '\0'.
+#define NO_NUMBER SIZE_MAX ///< Długość zwracana, gdy napis nie reprezentuje numeru.
+#define DIGIT_END (-1) ///< Wynik digit_at na końcu numeru.
+#define DIGIT_ERROR (-2) ///< Wynik digit_at dla znaku, który nie jest cyfrą.
+#define BULK_BUCKETS (ALPHABET_SIZE * (ALPHABET_SIZE + 1)) ///< Liczba części, na które phfwdLoadBulk dzieli przekierowania.
+#define BULK_CHUNK 4096 ///< Liczba par sprawdzanych przez phfwdLoadBulk w jednym zadaniu.
+#define BULK_MAX_THREADS 64 ///< Największa liczba wątków phfwdLoadBulk.
+#define NO_RULE_WORDS(entries) (((entries) + 63) / 64) ///< Liczba słów mapy bitowej no_rule dla danej liczby pól.
+#ifndef PHFWD_JUMP_DIGITS
+#define PHFWD_JUMP_DIGITS 3 ///< Liczba początkowych cyfr numeru, po których indeksuje tablica skoków.
+#endif
+
+#ifdef PHFWD_CONCURRENT
+#if defined(PHFWD_COMPACT_NODES) || !defined(__GNUC__)
+#error "PHFWD_CONCURRENT wymaga pełnych tablic dzieci i kompilatora GCC lub Clang."
+#endif
+/* Pola tablicy skoków trzeba by zmieniać razem z węzłami, których dotyczą,
+więc w wariancie współbieżnym tablica ma jedno pole: korzeń. */
+#undef PHFWD_JUMP_DIGITS
+#define PHFWD_JUMP_DIGITS 0
+#define LOAD_SHARED(field) __atomic_load_n(&(field), __ATOMIC_ACQUIRE) ///< Odczytuje pole, które może w tym czasie zmieniać wątek piszący.
+#define STORE_SHARED(field, value) __atomic_store_n(&(field), (value), __ATOMIC_RELEASE) ///< Zapisuje pole czytane przez inne wątki po wszystkich wcześniejszych zapisach.
+#else
+#define LOAD_SHARED(field) (field) ///< Odczytuje pole, które może w tym czasie zmieniać wątek piszący.
+#define STORE_SHARED(field, value) ((field) = (value)) ///< Zapisuje pole czytane przez inne wątki po wszystkich wcześniejszych zapisach.
+#endif
 
 /**
  * @brief Zmienia znak cyfry na odpowiadającą mu liczbę.
@@ -35,285 +73,697 @@ static int conversion(char n) {
 }
 
 /**
- * @brief To jest komparator napisów.
- * Porównuje ze sobą napisy pod kątem porządku leksykograficznego.
- * Służy do porównywania słów w tworzonych przez nas tablicach, dlatego
- * wiemy, że te słowa są poprawne.
- * @param[in] a - pierwszy numer (napis),
- * @param[in] b - drugi numer (napis).
- * @return Zwraca 1, gdy znak drugiego numeru jest większy, -1 gdy jest 
- *         odwrotnie lub 0, gdy napisy są równe.
+ * @brief To jest struktura przechowująca ciąg numerów telefonów.
+ * Cały ciąg leży w jednym bloku pamięci: za nagłówkiem jest tablica
+ * @p capacity pozycji numerów, a za nią znaki numerów, każdy zakończony
+ * znakiem '\0'. Pozycje są liczone od początku bloku, więc blok można
+ * przenieść funkcją realloc.
  */
-static int compare(char* a, char*b) {
-    if ((a != NULL) && (b != NULL)) {
-        size_t i = 0;
-        while ((a[i] != '\0') && (b[i] != '\0')) {
-            if (conversion(b[i]) > conversion(a[i])) {
-                return 1;
-            }
-            else if (conversion(a[i]) > conversion(b[i])) {
-                return -1;
-            }
-            else {
-                i++;
-            }
-        }
+struct PhoneNumbers {
+    size_t size; ///< Liczba numerów.
+    size_t capacity; ///< Liczba miejsc w tablicy pozycji.
+    size_t offsets[]; ///< Pozycje kolejnych numerów względem początku bloku.
+};
 
-        if (a[i] != '\0') {
-            return -1;
+/**
+ * @brief To jest struktura budująca blok PhoneNumbers.
+ * Blok rośnie funkcją realloc. Gdy brakuje miejsc w tablicy pozycji, znaki
+ * numerów są przesuwane dalej.
+ */
+struct NumbersBuilder {
+    PhoneNumbers *block; ///< Budowany blok lub NULL po błędzie alokacji.
+    size_t used; ///< Liczba zajętych bajtów bloku.
+    size_t allocated; ///< Rozmiar bloku w bajtach.
+};
+/**
+ * Tworzy typ NumbersBuilder.
+ */
+typedef struct NumbersBuilder NumbersBuilder;
+
+/**
+ * @brief To jest struktura przechowująca dzieci węzła drzewa.
+ * W wariancie PHFWD_COMPACT_NODES dzieci są trzymane w zwartej tablicy
+ * uporządkowanej według cyfr, a 12-bitowa mapa mówi, które cyfry mają
+ * dziecko. Pozycją dziecka w tablicy jest liczba zapalonych bitów mapy
+ * poniżej jego cyfry. W przeciwnym razie trzymamy pełną tablicę
+ * ALPHABET_SIZE odnośników.
+ */
+struct ChildSet {
+#ifdef PHFWD_COMPACT_NODES
+    uint16_t bitmap; ///< Bit i jest zapalony, gdy istnieje dziecko dla cyfry i.
+    NodeRef *dense; ///< Zwarta tablica dzieci.
+#else
+    NodeRef slots[ALPHABET_SIZE]; ///< Dziecko dla cyfry i lub NODE_NULL.
+#endif
+};
+/**
+ * Tworzy typ ChildSet.
+ */
+typedef struct ChildSet ChildSet;
+
+#ifdef PHFWD_COMPACT_NODES
+/**
+ * @brief Zlicza zapalone bity.
+ * @param[in] bits - badana liczba.
+ * @return Liczba zapalonych bitów.
+ */
+static inline int popcount(unsigned bits) {
+#if defined(__GNUC__)
+    return __builtin_popcount(bits);
+#else
+    int count = 0;
+    while (bits != 0) {
+        bits &= bits - 1;
+        count++;
+    }
+    return count;
+#endif
+}
+#endif
+
+/**
+ * @brief Tworzy pusty zbiór dzieci.
+ * @param[out] set - wskaźnik na inicjalizowany zbiór.
+ */
+static void child_init(ChildSet *set) {
+#ifdef PHFWD_COMPACT_NODES
+    set->bitmap = 0;
+    set->dense = NULL;
+#else
+    for (int i = 0; i < ALPHABET_SIZE; i++) {
+        set->slots[i] = NODE_NULL;
+    }
+#endif
+}
+
+/**
+ * @brief Zwalnia pamięć zbioru dzieci, nie ruszając samych dzieci.
+ * @param[in, out] set - wskaźnik na zbiór.
+ */
+static void child_clear(ChildSet *set) {
+#ifdef PHFWD_COMPACT_NODES
+    free(set->dense);
+#endif
+    child_init(set);
+}
+
+/**
+ * @brief Odczytuje dziecko dla danej cyfry.
+ * @param[in] set - wskaźnik na zbiór dzieci;
+ * @param[in] digit - cyfra od 0 do ALPHABET_SIZE - 1.
+ * @return Odnośnik do dziecka lub NODE_NULL, gdy go nie ma.
+ */
+static inline NodeRef child_get(ChildSet const *set, int digit) {
+#ifdef PHFWD_COMPACT_NODES
+    unsigned bit = 1u << digit;
+    if ((set->bitmap & bit) == 0) {
+        return NODE_NULL;
+    }
+    return set->dense[popcount(set->bitmap & (bit - 1))];
+#else
+    return LOAD_SHARED(set->slots[digit]);
+#endif
+}
+
+/**
+ * @brief Ustawia dziecko dla danej cyfry.
+ * Zastępuje dotychczasowe dziecko, jeśli istniało.
+ * @param[in, out] set - wskaźnik na zbiór dzieci;
+ * @param[in] digit - cyfra od 0 do ALPHABET_SIZE - 1;
+ * @param[in] child - odnośnik do dziecka, różny od NODE_NULL.
+ * @return Wartość @p false, gdy nie udało się alokować pamięci.
+ */
+static bool child_put(ChildSet *set, int digit, NodeRef child) {
+#ifdef PHFWD_COMPACT_NODES
+    unsigned bit = 1u << digit;
+    int position = popcount(set->bitmap & (bit - 1));
+    if ((set->bitmap & bit) == 0) {
+        int count = popcount(set->bitmap);
+        NodeRef *dense = realloc(set->dense, (count + 1) * sizeof(NodeRef));
+        if (dense == NULL) {
+            return false;
         }
-        else if (b[i] != '\0') {
-            return 1;
+        memmove(dense + position + 1, dense + position,
+                (count - position) * sizeof(NodeRef));
+        set->dense = dense;
+        set->bitmap |= bit;
+    }
+    set->dense[position] = child;
+#else
+    STORE_SHARED(set->slots[digit], child);
+#endif
+    return true;
+}
+
+/**
+ * @brief Usuwa dziecko dla danej cyfry.
+ * @param[in, out] set - wskaźnik na zbiór dzieci;
+ * @param[in] digit - cyfra od 0 do ALPHABET_SIZE - 1.
+ */
+static void child_remove(ChildSet *set, int digit) {
+#ifdef PHFWD_COMPACT_NODES
+    unsigned bit = 1u << digit;
+    if ((set->bitmap & bit) == 0) {
+        return;
+    }
+
+    int position = popcount(set->bitmap & (bit - 1));
+    int count = popcount(set->bitmap) - 1;
+    memmove(set->dense + position, set->dense + position + 1,
+            (count - position) * sizeof(NodeRef));
+    set->bitmap &= ~bit;
+    if (count == 0) {
+        free(set->dense);
+        set->dense = NULL;
+    }
+    else {
+        // Zmniejszenie tablicy może się nie udać, wtedy zostaje większa.
+        NodeRef *dense = realloc(set->dense, count * sizeof(NodeRef));
+        if (dense != NULL) {
+            set->dense = dense;
         }
-        else {
-            return 0;
+    }
+#else
+    STORE_SHARED(set->slots[digit], NODE_NULL);
+#endif
+}
+
+/**
+ * @brief Wyznacza dziecko o najmniejszej cyfrze.
+ * @param[in] set - wskaźnik na zbiór dzieci;
+ * @param[out] count - liczba dzieci, jeśli wskaźnik jest różny od NULL.
+ * @return Odnośnik do dziecka lub NODE_NULL, gdy zbiór jest pusty.
+ */
+static NodeRef child_first(ChildSet const *set, int *count) {
+#ifdef PHFWD_COMPACT_NODES
+    if (count != NULL) {
+        *count = popcount(set->bitmap);
+    }
+    return (set->bitmap == 0) ? NODE_NULL : set->dense[0];
+#else
+    NodeRef first = NODE_NULL;
+    int how_many = 0;
+    for (int i = 0; i < ALPHABET_SIZE; i++) {
+        NodeRef child = LOAD_SHARED(set->slots[i]);
+        if (child != NODE_NULL) {
+            if (first == NODE_NULL) {
+                first = child;
+            }
+            how_many++;
         }
     }
-    else {
-        return 0;
+
+    if (count != NULL) {
+        *count = how_many;
     }
+    return first;
+#endif
 }
 
 /**
- * @brief To jest struktura przechowująca ciąg numerów telefonów.
+ * @brief Wyznacza dziecko o najmniejszej cyfrze większej od danej.
+ * @param[in] set - wskaźnik na zbiór dzieci;
+ * @param[in] digit - cyfra od 0 do ALPHABET_SIZE - 1.
+ * @return Odnośnik do dziecka lub NODE_NULL, gdy takiego nie ma.
  */
-struct PhoneNumbers {
-    char **table_of_phone_numbers; ///< Wskaźnik na tablicę numerów telefonów.
-    size_t size; ///< Rozmiar tablicy.
-};
+static NodeRef child_after(ChildSet const *set, int digit) {
+#ifdef PHFWD_COMPACT_NODES
+    unsigned later = set->bitmap & ~((2u << digit) - 1);
+    if (later == 0) {
+        return NODE_NULL;
+    }
+    return set->dense[popcount(set->bitmap & ((later & -later) - 1))];
+#else
+    for (int i = digit + 1; i < ALPHABET_SIZE; i++) {
+        NodeRef child = LOAD_SHARED(set->slots[i]);
+        if (child != NODE_NULL) {
+            return child;
+        }
+    }
+    return NODE_NULL;
+#endif
+}
 
 /**
  * @brief To jest struktura przechowująca przekierowania numerów telefonów.
- * Przechowuję przekierowania w formie drzewa prefiksowego,
- * gdzie jeśli kolejną cyfrą w prefiksie pierwotnego drzewa prefiksowego jest
- * i, tablica children[i] trzyma przekierowanie kolejnej cyfry.
+ * Przechowuję przekierowania w formie skompresowanego drzewa prefiksowego
+ * (drzewa Patricia). Krawędź prowadząca do węzła jest opisana ciągiem co
+ * najwyżej LABEL_CAPACITY cyfr, a węzeł bez przekierowania ma zawsze co
+ * najmniej dwoje dzieci (poza korzeniem i łańcuchami zbyt długimi na jedną
+ * krawędź). Dziecko jest trzymane w children pod pierwszą cyfrą swojej
+ * etykiety. W wariancie PHFWD_CONCURRENT etykieta węzła widocznego dla
+ * wątków czytających się nie zmienia: dzieloną lub sklejaną krawędź
+ * zastępuje kopia węzła.
  */
 struct PhoneFWD {
-    struct PhoneFWD *children[ALPHABET_SIZE]; ///< Dalsze litery pierwotnego prefiksu.
-    char *prefix; ///< Wskaźnik na nowy prefiks.
-    struct PhoneFWD *father; ///< Wskaźnik na poprzedni węzeł drzewa przekierowań.
+    ChildSet children; ///< Dalsze litery pierwotnego prefiksu.
+    InternedString const *prefix; ///< Wskaźnik na nowy prefiks, numer z puli struktury.
+    InternedString const *source; ///< Numer ze ścieżki do węzła, z puli struktury, jeśli węzeł ma przekierowanie.
+    NodeRef reverse; ///< Węzeł drzewa odwróconego, w którego tablicy jest @p source, lub NODE_NULL.
+    NodeRef father; ///< Odnośnik do poprzedniego węzła drzewa przekierowań.
+    unsigned char label_length; ///< Liczba cyfr na krawędzi prowadzącej do węzła.
+    char label[LABEL_CAPACITY]; ///< Cyfry na krawędzi prowadzącej do węzła.
 };
 /**
  * Tworzy typ PhoneFWD.
  */
 typedef struct PhoneFWD PhoneFWD;
 
+/**
+ * @brief To jest posortowana tablica prefiksów węzła drzewa odwróconego.
+ * Liczba prefiksów leży w tym samym bloku co one, więc wątek czytający
+ * odczytuje obie jednym wskaźnikiem. W wariancie PHFWD_CONCURRENT zmiana
+ * tablicy tworzy nową, a starą zwalnia dopiero po zakończeniu odczytów.
+ */
+struct PrefixTable {
+    size_t count; ///< Liczba prefiksów, dodatnia.
+    InternedString const *items[]; ///< Prefiksy w porządku leksykograficznym.
+};
+/**
+ * Tworzy typ PrefixTable.
+ */
+typedef struct PrefixTable PrefixTable;
+
 /**
  * @brief To jest struktura przechowująca odwrócone drzewo numerów telefonów.
  * Przechowuję przekierowania w formie drzewa prefiksowego z tym, że tym razem
  * to znaki przekierowania są w formie węzłów, a prefiksy, które przekierowują
- * trzymane są w tablicy PhoneNumbers.
+ * trzymane są w posortowanej leksykograficznie tablicy numerów z puli
+ * struktury.
  */
 struct PhoneReversed {
-    struct PhoneReversed *children[ALPHABET_SIZE]; ///< Dalsze litery przekierowania.
-    struct PhoneNumbers *table_of_prefixes; ///< Wskaźnik na tablicę prefiksów.
-    struct PhoneReversed *father; ///< Wskaźnik na poprzedni węzeł drzewa odwróconego.
+    ChildSet children; ///< Dalsze litery przekierowania.
+    PrefixTable *prefixes; ///< Tablica prefiksów lub NULL, gdy jest pusta.
+    NodeRef father; ///< Odnośnik do poprzedniego węzła drzewa odwróconego.
 };
 /**
  * Tworzy typ PhoneReversed.
  */
 typedef struct PhoneReversed PhoneReversed;
 
+/**
+ * @brief To jest pole tablicy skoków.
+ * Opisuje stan wyszukiwania po przejściu PHFWD_JUMP_DIGITS początkowych cyfr
+ * numeru: najgłębszy węzeł drzewa prefiksów, którego cała ścieżka mieści się
+ * w tych cyfrach, i ostatnie przekierowanie na tej ścieżce.
+ */
+struct JumpEntry {
+    NodeRef node; ///< Najgłębszy węzeł zgodny z początkiem numeru.
+    InternedString const *prefix; ///< Ostatnie przekierowanie na ścieżce do @p node lub NULL.
+    unsigned char depth; ///< Długość ścieżki do węzła @p node.
+    unsigned char matched; ///< Długość prefiksu, którego dotyczy @p prefix.
+};
+/**
+ * Tworzy typ JumpEntry.
+ */
+typedef struct JumpEntry JumpEntry;
+
 /**
  * @brief To jest struktura przechowująca drzewo prefiksów i przekierowań.
+ * Węzły obu drzew pochodzą z pul należących do struktury, dzięki czemu
+ * usunięcie całej struktury zwalnia pamięć blokami. Numery trzymane w obu
+ * drzewach są współdzielone: każdy różny numer jest zapisany raz, po dwie
+ * cyfry w bajcie, a na napis zamieniamy go dopiero przy budowie wyniku.
  */
 struct PhoneForward {
-    PhoneFWD *new_tree; ///< Drzewo prefiksów.
-    PhoneReversed *reversed_tree; ///< Odwrócone drzewo przekierowań.
+    NodeRef new_tree; ///< Korzeń drzewa prefiksów.
+    NodeRef reversed_tree; ///< Korzeń odwróconego drzewa przekierowań.
+    NodePool fwd_pool; ///< Pula węzłów drzewa prefiksów.
+    NodePool rev_pool; ///< Pula węzłów drzewa odwróconego.
+    StringPool *strings; ///< Pula napisów numerów obu drzew.
+    NumberCache *cache; ///< Pamięć podręczna wyników phfwdGet lub NULL.
+    JumpEntry *jump; ///< Tablica skoków indeksowana początkowymi cyframi numeru.
+    uint64_t *no_rule; ///< Mapa bitowa pól tablicy skoków, których numerów nie dotyczy żadne przekierowanie.
+#ifdef PHFWD_CONCURRENT
+    EpochDomain *epoch; ///< Domena epok wątków czytających strukturę.
+#endif
 };
 
+/**
+ * @brief Wyznacza liczbę pól tablicy skoków.
+ * @return Liczba ALPHABET_SIZE do potęgi PHFWD_JUMP_DIGITS.
+ */
+static size_t jump_size(void) {
+    size_t size = 1;
+    for (int i = 0; i < PHFWD_JUMP_DIGITS; i++) {
+        size *= ALPHABET_SIZE;
+    }
+
+    return size;
+}
+
+/**
+ * @brief Udostępnia węzeł drzewa prefiksów.
+ * @param[in] pf - wskaźnik na strukturę przekierowań;
+ * @param[in] ref - odnośnik do węzła, różny od NODE_NULL.
+ * @return Wskaźnik na węzeł.
+ */
+static inline PhoneFWD * fwd_node(PhoneForward const *pf, NodeRef ref) {
+    return node_pool_get(&pf->fwd_pool, ref);
+}
+
+/**
+ * @brief Udostępnia węzeł drzewa odwróconego.
+ * @param[in] pf - wskaźnik na strukturę przekierowań;
+ * @param[in] ref - odnośnik do węzła, różny od NODE_NULL.
+ * @return Wskaźnik na węzeł.
+ */
+static inline PhoneReversed * rev_node(PhoneForward const *pf, NodeRef ref) {
+    return node_pool_get(&pf->rev_pool, ref);
+}
+
 /**
  * @brief Tworzy zaalokowaną strukturę PhoneFWD.
- * @return Zwraca zaalokowaną strukturę PhoneFWD.
+ * @param[in, out] pf - struktura, z której puli pochodzi węzeł.
+ * @return Odnośnik do nowego węzła lub NODE_NULL, gdy nie udało się alokować
+ *         pamięci.
  */
-static PhoneFWD * phfwdNew_help(void) {
-    PhoneFWD *new_struct = malloc(sizeof(PhoneFWD));
+static NodeRef phfwdNew_help(PhoneForward *pf) {
+    NodeRef ref = node_pool_alloc(&pf->fwd_pool);
     // Sprawdzam, czy alokowanie pamięci działa.
-    if (new_struct != NULL) {
-        for (int i = 0; i < ALPHABET_SIZE; i++) {
-            new_struct->children[i] = NULL;
-        }
-
+    if (ref != NODE_NULL) {
+        PhoneFWD *new_struct = fwd_node(pf, ref);
+        child_init(&new_struct->children);
         new_struct->prefix = NULL;
-        new_struct->father = NULL;
+        new_struct->source = NULL;
+        new_struct->reverse = NODE_NULL;
+        new_struct->father = NODE_NULL;
+        new_struct->label_length = 0;
     }
 
-    return new_struct;
+    return ref;
 }
 
 /**
  * @brief Tworzy zaalokowaną strukturę PhoneReversed.
- * @return Zwraca zaalokowaną strukturę PhoneReversed.
+ * @param[in, out] pf - struktura, z której puli pochodzi węzeł.
+ * @return Odnośnik do nowego węzła lub NODE_NULL, gdy nie udało się alokować
+ *         pamięci.
  */
-static PhoneReversed * phfwd_rev_New_help(void) {
-    PhoneReversed *new_struct = malloc(sizeof(PhoneReversed));
+static NodeRef phfwd_rev_New_help(PhoneForward *pf) {
+    NodeRef ref = node_pool_alloc(&pf->rev_pool);
     // Sprawdzam, czy alokowanie pamięci działa.
-    if (new_struct != NULL) {
-        for (int i = 0; i < ALPHABET_SIZE; i++) {
-            new_struct->children[i] = NULL;
-        }
-
-        new_struct->table_of_prefixes = NULL;
-        new_struct->father = NULL;
+    if (ref != NODE_NULL) {
+        PhoneReversed *new_struct = rev_node(pf, ref);
+        child_init(&new_struct->children);
+        new_struct->prefixes = NULL;
+        new_struct->father = NODE_NULL;
     }
 
-    return new_struct;
+    return ref;
+}
+
+/**
+ * @brief Zaczyna odczyt struktury.
+ * W wariancie PHFWD_CONCURRENT ogłasza odczyt w domenie epok struktury, więc
+ * do wywołania read_end wątek piszący nie zwolni pamięci, którą odczyt może
+ * zobaczyć. W pozostałych wariantach nic nie robi.
+ * @param[in] pf - wskaźnik na strukturę przekierowań.
+ * @return Numer miejsca odczytu w domenie epok.
+ */
+static inline size_t read_begin(PhoneForward const *pf) {
+#ifdef PHFWD_CONCURRENT
+    return epoch_enter(pf->epoch);
+#else
+    (void)pf;
+    return 0;
+#endif
+}
+
+/**
+ * @brief Kończy odczyt struktury rozpoczęty przez read_begin.
+ * @param[in] pf - wskaźnik na strukturę przekierowań;
+ * @param[in] slot - wynik read_begin.
+ */
+static inline void read_end(PhoneForward const *pf, size_t slot) {
+#ifdef PHFWD_CONCURRENT
+    epoch_exit(pf->epoch, slot);
+#else
+    (void)pf;
+    (void)slot;
+#endif
+}
+
+/**
+ * @brief Zwalnia pamięć, którą mogą jeszcze czytać inne wątki.
+ * W wariancie PHFWD_CONCURRENT odkłada zwolnienie do zakończenia trwających
+ * odczytów, a w pozostałych zwalnia pamięć od razu.
+ * @param[in, out] pf - wskaźnik na strukturę przekierowań;
+ * @param[in] memory - pamięć odpięta od struktury.
+ */
+static void shared_free(PhoneForward *pf, void *memory) {
+#ifdef PHFWD_CONCURRENT
+    epoch_defer_free(pf->epoch, memory);
+#else
+    (void)pf;
+    free(memory);
+#endif
+}
+
+/**
+ * @brief Oddaje węzeł drzewa prefiksów do puli.
+ * @param[in, out] context - wskaźnik na strukturę przekierowań;
+ * @param[in] item - odnośnik do węzła zapisany jako wskaźnik.
+ */
+static void release_fwd_ref(void *context, void *item) {
+    PhoneForward *pf = context;
+    NodeRef ref = (NodeRef)(uintptr_t)item;
+    child_clear(&fwd_node(pf, ref)->children);
+    node_pool_free(&pf->fwd_pool, ref);
+}
+
+/**
+ * @brief Oddaje do puli węzeł drzewa prefiksów odpięty od drzewa.
+ * W wariancie PHFWD_CONCURRENT węzeł może jeszcze czytać inny wątek, więc
+ * oddanie go odkładamy do zakończenia trwających odczytów. Do tego czasu
+ * węzeł się nie zmienia.
+ * @param[in, out] pf - wskaźnik na strukturę przekierowań;
+ * @param[in] ref - odnośnik do węzła.
+ */
+static void fwd_free(PhoneForward *pf, NodeRef ref) {
+#ifdef PHFWD_CONCURRENT
+    epoch_retire(pf->epoch, release_fwd_ref, pf, (void*)(uintptr_t)ref);
+#else
+    release_fwd_ref(pf, (void*)(uintptr_t)ref);
+#endif
+}
+
+/**
+ * @brief Zwalnia pamięć trzymaną przez węzeł drzewa prefiksów.
+ * Wywoływana dla każdego węzła puli przy usuwaniu struktury. Napisy zwalnia
+ * pula napisów.
+ * @param[in, out] node - wskaźnik na węzeł PhoneFWD.
+ */
+static void release_fwd_node(void *node) {
+    child_clear(&((PhoneFWD*)node)->children);
+}
+
+/**
+ * @brief Zwalnia pamięć trzymaną przez węzeł drzewa odwróconego.
+ * Wywoływana dla każdego węzła puli przy usuwaniu struktury. Napisy zwalnia
+ * pula napisów.
+ * @param[in, out] node - wskaźnik na węzeł PhoneReversed.
+ */
+static void release_rev_node(void *node) {
+    free(((PhoneReversed*)node)->prefixes);
+    child_clear(&((PhoneReversed*)node)->children);
+}
+
+void phfwdDelete(PhoneForward *pf) {
+    if (pf != NULL) {
+#ifdef PHFWD_CONCURRENT
+        // Odłożone zwolnienia oddają węzły do pul, więc wykonujemy je najpierw.
+        epoch_delete(pf->epoch);
+#endif
+        node_pool_destroy(&pf->fwd_pool, release_fwd_node);
+        node_pool_destroy(&pf->rev_pool, release_rev_node);
+        string_pool_delete(pf->strings);
+        number_cache_delete(pf->cache);
+        free(pf->jump);
+        free(pf->no_rule);
+        free(pf);
+    }
 }
 
 PhoneForward * phfwdNew(void) {
     PhoneForward *new_struct = malloc(sizeof(PhoneForward));
     if (new_struct != NULL) {
-        new_struct->new_tree = phfwdNew_help();
-        new_struct->reversed_tree = phfwd_rev_New_help();
+        node_pool_init(&new_struct->fwd_pool, sizeof(PhoneFWD));
+        node_pool_init(&new_struct->rev_pool, sizeof(PhoneReversed));
+        new_struct->strings = string_pool_new();
+        new_struct->cache = NULL;
+        new_struct->new_tree = phfwdNew_help(new_struct);
+        new_struct->reversed_tree = phfwd_rev_New_help(new_struct);
+        new_struct->jump = malloc(jump_size() * sizeof(JumpEntry));
+        new_struct->no_rule = malloc(NO_RULE_WORDS(jump_size()) *
+                                     sizeof(uint64_t));
+
+        bool failed = (new_struct->new_tree == NODE_NULL) ||
+                      (new_struct->reversed_tree == NODE_NULL) ||
+                      (new_struct->jump == NULL) ||
+                      (new_struct->no_rule == NULL) ||
+                      (new_struct->strings == NULL);
+#ifdef PHFWD_CONCURRENT
+        new_struct->epoch = epoch_new();
+        failed = failed || (new_struct->epoch == NULL);
+#endif
+        if (failed) {
+            phfwdDelete(new_struct);
+            return NULL;
+        }
+
+#ifdef PHFWD_CONCURRENT
+        /* Pamięć, którą mogą czytać inne wątki, pule zwalniają przez domenę
+        epok. */
+        new_struct->fwd_pool.retire = epoch_defer_free;
+        new_struct->fwd_pool.retire_context = new_struct->epoch;
+        new_struct->rev_pool.retire = epoch_defer_free;
+        new_struct->rev_pool.retire_context = new_struct->epoch;
+        new_struct->strings->retire = epoch_defer_free;
+        new_struct->strings->retire_context = new_struct->epoch;
+#endif
+
+        /* W pustym drzewie każde wyszukiwanie zaczyna się w korzeniu i żadne
+        przekierowanie nie pasuje. */
+        for (size_t i = 0; i < jump_size(); i++) {
+            new_struct->jump[i] = (JumpEntry){new_struct->new_tree, NULL, 0, 0};
+        }
+        memset(new_struct->no_rule, 0xFF,
+               NO_RULE_WORDS(jump_size()) * sizeof(uint64_t));
     }
 
     return new_struct;
 }
 
 /**
- * @brief Funkcja tworzy jednoelementowy węzeł PhoneNumbers.
- * @return Wskaźnik na zaalokowaną strukturę.
+ * @brief Zaczyna budowę bloku PhoneNumbers.
+ * @param[out] builder - wskaźnik na budowniczego;
+ * @param[in] count - przewidywana liczba numerów;
+ * @param[in] chars - przewidywana liczba znaków numerów, razem ze znakami
+ *                    '\0'.
+ * @return Wartość @p false, jeśli nie udało się alokować pamięci.
  */
-static PhoneNumbers * phnum_new_one(void) {
-    PhoneNumbers *new = malloc(sizeof(PhoneNumbers));
-    if (new != NULL) {
-        new->size = 1;
-        new->table_of_phone_numbers = malloc(sizeof(char*));
-
-        if (new->table_of_phone_numbers != NULL) {
-            new->table_of_phone_numbers[0] = NULL;
-        }
+static bool builder_init(NumbersBuilder *builder, size_t count, size_t chars) {
+    builder->used = sizeof(PhoneNumbers) + count * sizeof(size_t);
+    builder->allocated = builder->used + chars;
+    builder->block = malloc(builder->allocated);
+    if (builder->block == NULL) {
+        return false;
     }
+    builder->block->size = 0;
+    builder->block->capacity = count;
 
-    return new;
+    return true;
 }
 
 /**
- * @brief Funkcja usuwa drzewo prefiksowe przekierowań.
- * @param[in] pf - wskaźnik na drzewo.
+ * @brief Dodaje numer na koniec budowanego bloku.
+ * Jeśli nie uda się alokować pamięci, zwalnia blok.
+ * @param[in, out] builder - wskaźnik na budowniczego;
+ * @param[in] length - liczba cyfr numeru.
+ * @return Wskaźnik na miejsce na @p length cyfr i znak '\0', ważny do
+ *         następnego wywołania funkcji, lub NULL, gdy nie udało się alokować
+ *         pamięci.
  */
-static void phfwdDelete_help(PhoneFWD *pf) {
-    // Funkcja iteracyjnie usuwa dane poddrzewo, o korzeniu w pf.
-    if (pf == NULL) {
-        return;
+static char * builder_add(NumbersBuilder *builder, size_t length) {
+    PhoneNumbers *block = builder->block;
+    if (block == NULL) {
+        return NULL;
     }
 
-    PhoneFWD *current = pf;
-    PhoneFWD *parent = NULL;
-    PhoneFWD *root = pf->father;
+    size_t capacity = block->capacity;
+    size_t extra = 0;
+    if (block->size == capacity) {
+        capacity = 2 * capacity + 1;
+        extra = (capacity - block->capacity) * sizeof(size_t);
+    }
 
-    while (current != root) {
-        bool if_continue = 1;
-        for (int i = 0; i < ALPHABET_SIZE; i++) {
-            if (current->children[i] != NULL) {
-                current = current->children[i];
-                if_continue = 0;
-                break;
-            }
+    size_t needed = builder->used + extra + length + 1;
+    if (needed > builder->allocated) {
+        size_t allocated = 2 * builder->allocated;
+        if (allocated < needed) {
+            allocated = needed;
         }
-
-        if (if_continue) {
-            parent = current->father;
-            if (parent != NULL) {
-                for (int i = 0; i < ALPHABET_SIZE; i++) {
-                    if (parent->children[i] == current) {
-                        parent->children[i] = NULL;
-                        break;
-                    }
-                }
-            }
-
-            free(current->prefix);
-            free(current);
-            current = parent;
+        block = realloc(block, allocated);
+        if (block == NULL) {
+            free(builder->block);
+            builder->block = NULL;
+            return NULL;
         }
-    }  
-}
+        builder->block = block;
+        builder->allocated = allocated;
+    }
 
-void phnumDelete(PhoneNumbers *pnum) {
-    if (pnum != NULL) {
-        if (pnum->table_of_phone_numbers != NULL) {
-            for (size_t i = 0; i < (pnum->size); i++) {
-                if (pnum->table_of_phone_numbers[i] != NULL) {
-                    free(pnum->table_of_phone_numbers[i]);
-                }
-            }
-            free(pnum->table_of_phone_numbers);
+    if (extra > 0) {
+        size_t chars = sizeof(PhoneNumbers) + block->capacity * sizeof(size_t);
+        memmove((char*)block + chars + extra, (char*)block + chars,
+                builder->used - chars);
+        for (size_t i = 0; i < block->size; i++) {
+            block->offsets[i] += extra;
         }
-        free(pnum);
+        block->capacity = capacity;
+        builder->used += extra;
     }
+
+    block->offsets[block->size++] = builder->used;
+    char *out = (char*)block + builder->used;
+    builder->used += length + 1;
+
+    return out;
 }
 
 /**
- * @brief Funkcja usuwa odwrócone drzewo prefiksowe.
- * @param[in] pf - wskaźnik na odwrócone drzewo.
+ * @brief Kończy budowę bloku PhoneNumbers.
+ * Oddaje nadmiar pamięci, jeśli zajmuje ponad połowę bloku.
+ * @param[in, out] builder - wskaźnik na budowniczego.
+ * @return Wskaźnik na zbudowaną strukturę lub NULL, jeśli wcześniej nie
+ *         udało się alokować pamięci.
  */
-static void phfwdDelete_rev_help(PhoneReversed *pf) {
-    // Funkcja iteracyjnie usuwa dane poddrzewo, o korzeniu w pf.
-    if (pf == NULL) {
-        return;
+static PhoneNumbers * builder_finish(NumbersBuilder *builder) {
+    if ((builder->block != NULL) &&
+        (builder->allocated - builder->used > builder->used)) {
+        PhoneNumbers *block = realloc(builder->block, builder->used);
+        if (block != NULL) {
+            builder->block = block;
+            builder->allocated = builder->used;
+        }
     }
 
-    PhoneReversed *current = pf;
-    PhoneReversed *parent = NULL;
-    PhoneReversed *root = pf->father;
-
-    while (current != root) {
-        bool if_continue = 1;
-
-        for (int i = 0; i < ALPHABET_SIZE; i++) {
-            if (current->children[i] != NULL) {
-                current = current->children[i];
-                if_continue = 0;
-                break;
-            }
-        }
+    return builder->block;
+}
 
-        if (if_continue) {
-            parent = current->father;
-            if (parent != NULL) {
-                for (int i = 0; i < ALPHABET_SIZE; i++) {
-                    if (parent->children[i] == current) {
-                        parent->children[i] = NULL;
-                        break;
-                    }
-                }
-            }
+/**
+ * @brief Funkcja tworzy pusty ciąg numerów.
+ * @return Wskaźnik na zaalokowaną strukturę lub NULL, gdy nie udało się
+ *         alokować pamięci.
+ */
+static PhoneNumbers * phnum_new_empty(void) {
+    NumbersBuilder builder;
+    builder_init(&builder, 0, 0);
 
-            if (current != NULL) {
-                if (current->table_of_prefixes != NULL) {
-                    if (current->table_of_prefixes->table_of_phone_numbers
-                        != NULL) {
-                        for (size_t i = 0;
-                             i < (current->table_of_prefixes->size); i++) {
-                            if 
-                            (current->table_of_prefixes->table_of_phone_numbers
-                            [i] != NULL) {
-                                free
-                                (current->table_of_prefixes->table_of_phone_numbers[i]);
-                            }
-                        }
-                        free(current->table_of_prefixes->table_of_phone_numbers);
-                    }
-                    free(current->table_of_prefixes);
-                }
+    return builder_finish(&builder);
+}
 
-                if (current->children != NULL) {
-                    free(current->children);
-                }
+/**
+ * @brief Funkcja tworzy jednoelementowy ciąg numerów.
+ * @param[in] length - liczba cyfr numeru;
+ * @param[out] out - miejsce na wskaźnik, pod który trzeba zapisać
+ *                   @p length cyfr numeru i znak '\0'.
+ * @return Wskaźnik na zaalokowaną strukturę lub NULL, gdy nie udało się
+ *         alokować pamięci.
+ */
+static PhoneNumbers * phnum_new_single(size_t length, char **out) {
+    NumbersBuilder builder;
+    if (!builder_init(&builder, 1, length + 1)) {
+        return NULL;
+    }
+    *out = builder_add(&builder, length);
 
-                current = parent;
-            }
-        }
-    }  
+    return builder_finish(&builder);
 }
 
-void phfwdDelete(PhoneForward *pf) {
-    if (pf != NULL) {
-        phfwdDelete_help(pf->new_tree);
-        phfwdDelete_rev_help(pf->reversed_tree);
-        free(pf);
-    }
+void phnumDelete(PhoneNumbers *pnum) {
+    free(pnum);
 }
 
 /**
@@ -362,833 +812,3268 @@ static bool error(char *num) {
 }
 
 /**
- * @brief Sprawdza, czy dane 2 napisy są takie same.
- * @param[in] num1 - wskaźnik na pierwszy napis;
- * @param[in] num2 - wskaźnik na drugi napis.
- * @return Wartość @p true, gdy napisy są takie same. 
- *         Wartość @p false, gdy napisy są różne.
+ * @brief Odczytuje cyfrę numeru o znanej lub nieznanej długości.
+ * Numer kończy się po @p length znakach, a jeśli @p length jest równe
+ * NUL_TERMINATED, na znaku '\0'. Znak '\0' wewnątrz numeru o znanej długości
+ * nie jest cyfrą.
+ * @param[in] num - wskaźnik na numer;
+ * @param[in] i - indeks odczytywanego znaku;
+ * @param[in] length - długość numeru lub NUL_TERMINATED.
+ * @return Cyfra od 0 do 11, DIGIT_END na końcu numeru lub DIGIT_ERROR.
  */
-static bool check_if_same (char *num1, char *num2) {
-    size_t i = 0;
-    while ((num1[i] != '\0') && (num2[i] != '\0')) {
-        if (num1[i] != num2[i]) {
-            return false;
-        }
-        i++;
+static inline int digit_at(char const *num, size_t i, size_t length) {
+    if (i == length) {
+        return DIGIT_END;
     }
 
-    if (num1[i] != num2[i]) {
-        return false;
+    char character = num[i];
+    if ((character >= '0') && (character <= '9')) {
+        return character - '0';
+    }
+    else if (character == TEN) {
+        return 10;
+    }
+    else if (character == ELEVEN) {
+        return 11;
+    }
+    else if ((character == '\0') && (length == NUL_TERMINATED)) {
+        return DIGIT_END;
     }
-    
-    return true;
-}
-
 
+    return DIGIT_ERROR;
+}
 
 /**
- * @brief Sprawdza obecność przypadków szczególnych w napisach.
- * Funkcja sprawdza, czy dane 2 napisy są takie same, czy któryś z nich
- * jest pusty lub niepoprawny. W takim przypadku przekazuję tę informację dalej.
- * @param[in] num1 - wskaźnik na dany napis;
- * @param[in] num2 - wskaźnik na dany napis.
- * @return Wartość @p true, gdy nie zachodzą specjalne przypadki,
- *         wartość @p false, gdy zachodzi któryś przypadek.
+ * @brief Sprawdza nieprzejrzaną jeszcze końcówkę numeru.
+ * @param[in] num - wskaźnik na numer;
+ * @param[in] i - liczba początkowych znaków, o których wiadomo, że są cyframi;
+ * @param[in] length - długość numeru lub NUL_TERMINATED.
+ * @return Liczba cyfr numeru lub NO_NUMBER, gdy numer zawiera inny znak.
  */
-static bool special_cases(char *num1, char *num2) {
-    if ((num1 == NULL) || (num2 == NULL) ||
-        (num1[0] == '\0') || (num2[0] == '\0')) {
-        return false;
+static size_t number_length(char const *num, size_t i, size_t length) {
+    int digit = digit_at(num, i, length);
+    while (digit >= 0) {
+        i++;
+        digit = digit_at(num, i, length);
     }
 
-    if (error(num1) || error(num2)) {
-        return false;
-    }
+    return (digit == DIGIT_END) ? i : NO_NUMBER;
+}
 
-    if (check_if_same(num1, num2) == 1) {
-        return false;
+/**
+ * @brief Szuka miejsca numeru w posortowanej tablicy prefiksów węzła.
+ * @param[in] table - wskaźnik na tablicę prefiksów lub NULL;
+ * @param[in] num - numer spakowany po dwie cyfry w bajcie;
+ * @param[in] length - liczba cyfr numeru.
+ * @return Indeks pierwszego prefiksu nie mniejszego od @p num.
+ */
+static size_t prefix_lower_bound(PrefixTable const *table,
+                                 unsigned char const *num, size_t length) {
+    size_t low = 0;
+    size_t high = (table == NULL) ? 0 : table->count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (string_pool_compare(table->items[middle], num, length) < 0) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
     }
 
-    return true;
+    return low;
 }
 
 /**
  * @brief Funkcja znajduje prefiks, który trzeba usunąć w konkretnym węźle.
- * @param[in, out] pf - wskaźnik na drzewo odwrócone;
- * @param[in] num - usuwany napis.
- */
-static void remove_cell(PhoneReversed *pf, char *num) {
-    if (pf->table_of_prefixes != NULL && 
-        pf->table_of_prefixes->table_of_phone_numbers != NULL) {
-        size_t count_rubbish = 0;
-        size_t index = pf->table_of_prefixes->size - 1;
-
-        for (size_t i = pf->table_of_prefixes->size ; i > 0; i--) {
-            size_t j = 0;
-            /* Szukamy różnycy pomiędzy num i napisem, jeśli num jest
-            zawiera się w napisie, usuwamy napis. */
-            while ((if_correct(num[j])!= END) && 
-                  (if_correct
-                  (pf->table_of_prefixes->table_of_phone_numbers[i - 1][j]
-                  != END)) && 
-                  (num[j] == pf->table_of_prefixes->table_of_phone_numbers[i - 1][j])) {
-                j++;
-            }
+ * Usuwa z tablicy węzła wszystkie prefiksy, których początkiem jest @p num.
+ * Tablica jest posortowana, więc tworzą one jeden spójny fragment.
+ * @param[in, out] pf - wskaźnik na strukturę z pulą numerów;
+ * @param[in, out] node - wskaźnik na węzeł drzewa odwróconego;
+ * @param[in] num - usuwany numer, spakowany po dwie cyfry w bajcie;
+ * @param[in] length - liczba cyfr usuwanego numeru.
+ */
+static void remove_cell(PhoneForward *pf, PhoneReversed *node,
+                        unsigned char const *num, size_t length) {
+    PrefixTable *table = node->prefixes;
+    if (table == NULL) {
+        return;
+    }
 
-            if ((i == 1) && (index == 0) && (if_correct(num[j]) == END)) {
-                for (size_t ii = pf->table_of_prefixes->size; ii > 0; ii--) {
-                    free(pf->table_of_prefixes->table_of_phone_numbers[ii - 1]);
-                         pf->table_of_prefixes->size = 0;
-                }
-                return;
-            }
-            else if (if_correct(num[j]) == END) {
-                char* tmp = pf->table_of_prefixes->table_of_phone_numbers[index];
-                pf->table_of_prefixes->table_of_phone_numbers[index] = pf->table_of_prefixes->table_of_phone_numbers[i - 1];
-                pf->table_of_prefixes->table_of_phone_numbers[i - 1] = tmp;
-            
-                index--;
-                count_rubbish++;
-            }
-        }
+    size_t first = prefix_lower_bound(table, num, length);
+    size_t last = first;
+    // Jeśli num zawiera się w napisie, usuwamy napis.
+    while ((last < table->count) &&
+           string_pool_starts_with(table->items[last], num, length)) {
+        last++;
+    }
+    if (last == first) {
+        return;
+    }
 
-        size_t size = pf->table_of_prefixes->size - count_rubbish;
-        if (size != 0) {
-            for (size_t ii = pf->table_of_prefixes->size; ii > size; ii--) {
-                free(pf->table_of_prefixes->table_of_phone_numbers[ii - 1]);
-            }
-            pf->table_of_prefixes->table_of_phone_numbers =
-            realloc(pf->table_of_prefixes->table_of_phone_numbers, size * 
-                   (sizeof(char*)));
-            pf->table_of_prefixes->size = size;
-        }
-        else {
-            for (size_t ii = pf->table_of_prefixes->size; ii > 0; ii--) {
-                free(pf->table_of_prefixes->table_of_phone_numbers[ii - 1]);
-            }
-            pf->table_of_prefixes->size = size;
+    size_t count = table->count - (last - first);
+    PrefixTable *smaller = table;
+#ifdef PHFWD_CONCURRENT
+    /* Starą tablicę mogą czytać inne wątki, więc budujemy nową. Gdy nie uda
+    się jej alokować, prefiksy zostają: phfwdReverse zwraca wtedy nadmiarowe
+    numery, które phfwdGetReverse i tak odrzuca. */
+    smaller = NULL;
+    if (count > 0) {
+        smaller = malloc(sizeof(PrefixTable) +
+                         count * sizeof(InternedString const*));
+        if (smaller == NULL) {
+            return;
         }
+        memcpy(smaller->items, table->items,
+               first * sizeof(InternedString const*));
+    }
+#endif
+    for (size_t i = first; i < last; i++) {
+        string_pool_release(pf->strings, table->items[i]);
+    }
+
+    if (count == 0) {
+        STORE_SHARED(node->prefixes, NULL);
+        shared_free(pf, table);
+        return;
+    }
+    memmove(smaller->items + first, table->items + last,
+            (table->count - last) * sizeof(InternedString const*));
+    smaller->count = count;
+    if (smaller != table) {
+        STORE_SHARED(node->prefixes, smaller);
+        shared_free(pf, table);
     }
 }
 
 /**
- * @brief Funkcja znajduje konkretny węzeł, z którego trzeba usunąć przy nadpisaniu. przekierowania z drzewa odwróconego.
- * @param[in, out] pf - wskaźnik na strukturę z odwróconym drzewem;
- * @param[in] where - napis, za pomocą którego znajdujemy węzeł;
- * @param[in] what_to_remove_cell - usuwany napis.
+ * @brief Usuwa z drzewa odwróconego wpisy przekierowania węzła.
+ * Węzeł drzewa odwróconego znajduje po odnośniku zapisanym w węźle, więc nie
+ * przegląda drzewa odwróconego. Razem z numerem węzła usuwa z tablicy numery,
+ * które się od niego zaczynają, tak jak remove_cell. Należą one do
+ * przekierowań z poddrzewa węzła.
+ * @param[in, out] pf - wskaźnik na strukturę przekierowań;
+ * @param[in, out] node - wskaźnik na węzeł z przekierowaniem.
  */
-static void remove_cell_certain (PhoneForward *pf, char *where,
-                                 char *what_to_remove_cell) {
-    if (pf != NULL) {
-        if (where != NULL && where[0] != '\0') {
-            PhoneReversed *current = pf->reversed_tree;
-            size_t i = 0;
-            while ((where[i] != '\0') &&
-                  (current->children[conversion(where[i])] != NULL )) {
-                current = current->children[conversion(where[i])];
-                i++;
-            }
-
-            if (where[i] == '\0') {
-                remove_cell(current, what_to_remove_cell);
-            }
-        }
+static void remove_reverse_entry(PhoneForward *pf, PhoneFWD *node) {
+    if (node->reverse != NODE_NULL) {
+        remove_cell(pf, rev_node(pf, node->reverse), node->source->digits,
+                    node->source->length);
+        node->reverse = NODE_NULL;
     }
+
+    string_pool_release(pf->strings, node->source);
+    node->source = NULL;
 }
 
 /**
- * @brief Funkcja spełnia zadanie phfwdAdd dla drzewa nieodwróconego.
- * @param [in, out] pf - wskaźnik na strukturę przechowującą przekierowania
- *                       numerów;
- * @param[in] num1 - wskaźnik na napis reprezentujący prefiks numerów
- *                   przekierowywanych;
- * @param[in] num2 - wskaźnik na napis reprezentujący prefiks numerów,
- *                   na które jest wykonywane przekierowanie;
- * @param pf1 - wskaźnik na strukturę PhoneForward przekazywaną dalej 
- *              w przypadku nadpisania.
- * @return Wartość @p true, jeśli przekierowanie zostało dodane.
- *         Wartość @p false, jeśli wystąpił błąd, np. podany napis nie
- *         reprezentuje numeru, oba podane numery są identyczne lub nie udało
- *         się alokować pamięci.
- */
-static bool phfwdAdd_help(PhoneFWD *pf, char *num1, char *num2,
-                          PhoneForward *pf1) {
-    /* Na początku sprawdzam przypadki szczególne, oznaczające
-    brak dalszej pracy na wskaźniku pf. */
-    PhoneFWD *current_node = pf;
-    if (pf == NULL) {
-        return 0;
+ * @brief Wyznacza pierwszy w kolejności cyfr liść poddrzewa.
+ * @param[in] pf - wskaźnik na strukturę przekierowań;
+ * @param[in] ref - odnośnik do korzenia poddrzewa.
+ * @return Odnośnik do liścia.
+ */
+static NodeRef first_leaf(PhoneForward const *pf, NodeRef ref) {
+    NodeRef child = child_first(&fwd_node(pf, ref)->children, NULL);
+    while (child != NODE_NULL) {
+        ref = child;
+        child = child_first(&fwd_node(pf, ref)->children, NULL);
     }
 
-    size_t i = 0;
-    /* Szukamy, czy w dzieciach jest już dana cyfra, jak nie, tworzymy nowego 
-    syna i jego dalej przeszukujemy */
-    while (if_correct(num1[i]) == CORRECT) {
-        if (current_node->children[conversion(num1[i])] != NULL) {
-            current_node = current_node->children[conversion(num1[i])];
+    return ref;
+}
+
+/**
+ * @brief Funkcja usuwa poddrzewo drzewa prefiksowego przekierowań.
+ * Odpina poddrzewo od ojca jednym zapisem, a potem zwraca jego węzły do puli
+ * od liści w górę, nie zmieniając ich. Wątek czytający, który zdążył wejść
+ * do poddrzewa, widzi je więc w całości.
+ * @param[in, out] pf - wskaźnik na strukturę przekierowań;
+ * @param[in] subtree - odnośnik do korzenia poddrzewa, różnego od korzenia
+ *                      drzewa.
+ */
+static void phfwdDelete_help(PhoneForward *pf, NodeRef subtree) {
+    if (subtree == NODE_NULL) {
+        return;
+    }
+
+    // Pierwsza cyfra etykiety wyznacza miejsce węzła w ojcu.
+    PhoneFWD *top = fwd_node(pf, subtree);
+    child_remove(&fwd_node(pf, top->father)->children,
+                 conversion(top->label[0]));
+
+    /* Dzieci węzła zwalniamy przed nim, w kolejności cyfr. Dzieci ojca
+    zwolnionego węzła nie zmieniamy, więc po nim przechodzimy do następnego
+    z nich. */
+    NodeRef current = first_leaf(pf, subtree);
+    while (true) {
+        PhoneFWD *node = fwd_node(pf, current);
+        NodeRef parent = node->father;
+        int digit = conversion(node->label[0]);
+        if (node->prefix != NULL) {
+            remove_reverse_entry(pf, node);
         }
-        else {
-            PhoneFWD *tmp = phfwdNew_help();
-            if (tmp == NULL) {
-                return 0;
-            }
-            tmp->father = current_node;
-            current_node->children[conversion(num1[i])] = tmp;
-            current_node = current_node->children[conversion(num1[i])];
+        string_pool_release(pf->strings, node->prefix);
+        fwd_free(pf, current);
+        if (current == subtree) {
+            return;
         }
+
+        NodeRef next = child_after(&fwd_node(pf, parent)->children, digit);
+        current = (next == NODE_NULL) ? parent : first_leaf(pf, next);
+    }
+}
+
+/**
+ * @brief Wyznacza długość wspólnego początku etykiety węzła i napisu.
+ * Porównanie kończy się na końcu etykiety, na pierwszym niezgodnym znaku
+ * lub na końcu napisu. Etykieta składa się z cyfr, więc zgodne znaki napisu
+ * są poprawnymi cyframi.
+ * @param[in] node - węzeł, którego etykietę porównujemy;
+ * @param[in] num - wskaźnik na porównywany fragment numeru;
+ * @param[in] limit - największa liczba porównywanych znaków.
+ * @return Liczba zgodnych cyfr.
+ */
+static size_t label_match(PhoneFWD const *node, char const *num, size_t limit) {
+    size_t i = 0;
+    while ((i < node->label_length) && (i < limit) &&
+           (num[i] == node->label[i])) {
         i++;
     }
 
-    // Na koniec zapisujemy napis, na który przekierowujemy.
-    size_t z = 0;
-    while (if_correct(num2[z]) == CORRECT) {
-        z++;
+    return i;
+}
+
+#ifdef PHFWD_CONCURRENT
+/**
+ * @brief Tworzy kopię węzła drzewa prefiksów.
+ * Kopia nie jest jeszcze podpięta do drzewa, więc można ją zmieniać, zanim
+ * zastąpi węzeł.
+ * @param[in, out] pf - wskaźnik na strukturę przekierowań;
+ * @param[in] ref - odnośnik do kopiowanego węzła.
+ * @return Odnośnik do kopii lub NODE_NULL, gdy nie udało się alokować
+ *         pamięci.
+ */
+static NodeRef clone_node(PhoneForward *pf, NodeRef ref) {
+    NodeRef copy = node_pool_alloc(&pf->fwd_pool);
+    if (copy != NODE_NULL) {
+        *fwd_node(pf, copy) = *fwd_node(pf, ref);
     }
 
-    if (current_node->prefix != NULL) {
-        remove_cell_certain(pf1, current_node->prefix, num1);
+    return copy;
+}
+
+/**
+ * @brief Ustawia węzeł jako ojca wszystkich jego dzieci.
+ * Wywoływana po podpięciu kopii węzła w miejsce oryginału.
+ * @param[in, out] pf - wskaźnik na strukturę przekierowań;
+ * @param[in] ref - odnośnik do węzła.
+ */
+static void adopt_children(PhoneForward *pf, NodeRef ref) {
+    ChildSet const *children = &fwd_node(pf, ref)->children;
+    for (int digit = 0; digit < ALPHABET_SIZE; digit++) {
+        NodeRef child = child_get(children, digit);
+        if (child != NODE_NULL) {
+            fwd_node(pf, child)->father = ref;
+        }
     }
+}
+#endif
 
-    free(current_node->prefix);
-    current_node->prefix = malloc(sizeof(char)*(z + 1));
-    if (current_node->prefix == NULL) {
-        return 0;
+/**
+ * @brief Dzieli krawędź prowadzącą do węzła.
+ * Wstawia nad węzłem @p node nowy węzeł, którego etykietą jest pierwsze
+ * @p length cyfr etykiety @p node. Węzeł @p node zachowuje pozostałe cyfry,
+ * a w wariancie PHFWD_CONCURRENT zastępuje go kopia z pozostałymi cyframi.
+ * @param[in, out] pf - wskaźnik na strukturę przekierowań;
+ * @param[in, out] node - odnośnik do węzła, którego krawędź dzielimy;
+ * @param[in] length - długość etykiety nowego węzła, mniejsza od długości
+ *                     etykiety @p node.
+ * @return Odnośnik do nowego węzła lub NODE_NULL, gdy nie udało się alokować
+ *         pamięci.
+ */
+static NodeRef split_node(PhoneForward *pf, NodeRef node, size_t length) {
+    NodeRef middle_ref = phfwdNew_help(pf);
+    if (middle_ref == NODE_NULL) {
+        return NODE_NULL;
+    }
+
+#ifdef PHFWD_CONCURRENT
+    // Etykietę węzła mogą czytać inne wątki, więc skracamy ją w kopii.
+    NodeRef lower_ref = clone_node(pf, node);
+    if (lower_ref == NODE_NULL) {
+        node_pool_free(&pf->fwd_pool, middle_ref);
+        return NODE_NULL;
+    }
+#else
+    NodeRef lower_ref = node;
+#endif
+    PhoneFWD *middle = fwd_node(pf, middle_ref);
+    PhoneFWD *lower = fwd_node(pf, lower_ref);
+    int digit = conversion(lower->label[0]);
+    if (!child_put(&middle->children, conversion(lower->label[length]),
+                   lower_ref)) {
+        if (lower_ref != node) {
+            node_pool_free(&pf->fwd_pool, lower_ref);
+        }
+        node_pool_free(&pf->fwd_pool, middle_ref);
+        return NODE_NULL;
+    }
+
+    memcpy(middle->label, lower->label, length);
+    middle->label_length = length;
+    middle->father = lower->father;
+    lower->label_length -= length;
+    memmove(lower->label, lower->label + length, lower->label_length);
+    lower->father = middle_ref;
+    child_put(&fwd_node(pf, middle->father)->children, digit, middle_ref);
+#ifdef PHFWD_CONCURRENT
+    adopt_children(pf, lower_ref);
+    fwd_free(pf, node);
+#endif
+
+    return middle_ref;
+}
+
+/**
+ * @brief Przywraca kompresję ścieżki po usunięciu poddrzewa.
+ * Usuwa kolejne węzły bez dzieci i bez przekierowania, idąc w stronę
+ * korzenia, a następnie skleja krawędź pierwszego pozostawionego węzła
+ * z krawędzią jego jedynego dziecka, jeśli to możliwe.
+ * @param[in, out] pf - wskaźnik na strukturę przekierowań;
+ * @param[in] ref - odnośnik do ojca usuniętego poddrzewa.
+ * @return Najniższy pozostawiony węzeł ścieżki; wszystkie usunięte węzły
+ *         leżą w jego poddrzewie.
+ */
+static NodeRef compress_path(PhoneForward *pf, NodeRef ref) {
+    PhoneFWD *node = fwd_node(pf, ref);
+    while ((node->father != NODE_NULL) && (node->prefix == NULL)) {
+        int count = 0;
+        NodeRef only_child = child_first(&node->children, &count);
+
+        NodeRef father = node->father;
+        if (count == 0) {
+            child_remove(&fwd_node(pf, father)->children,
+                         conversion(node->label[0]));
+            fwd_free(pf, ref);
+            ref = father;
+            node = fwd_node(pf, ref);
+            continue;
+        }
+
+        if ((count == 1) && (node->label_length +
+            fwd_node(pf, only_child)->label_length <= LABEL_CAPACITY)) {
+#ifdef PHFWD_CONCURRENT
+            // Sklejoną krawędź zapisujemy w kopii dziecka.
+            NodeRef merged = clone_node(pf, only_child);
+            if (merged == NODE_NULL) {
+                return ref;
+            }
+#else
+            NodeRef merged = only_child;
+#endif
+            PhoneFWD *child = fwd_node(pf, merged);
+            memmove(child->label + node->label_length, child->label,
+                    child->label_length);
+            memcpy(child->label, node->label, node->label_length);
+            child->label_length += node->label_length;
+            child->father = father;
+            child_put(&fwd_node(pf, father)->children,
+                      conversion(node->label[0]), merged);
+#ifdef PHFWD_CONCURRENT
+            adopt_children(pf, merged);
+            fwd_free(pf, only_child);
+#endif
+            fwd_free(pf, ref);
+            return father;
+        }
+        return ref;
+    }
+
+    return ref;
+}
+
+/**
+ * @brief Wyznacza od nowa pole tablicy skoków.
+ * Cyfry numeru pola są początkowymi cyframi numerów, które z niego korzystają.
+ * Schodzi od korzenia po całych krawędziach, dopóki mieszczą się w tych
+ * cyfrach. Ustawia też bit pola w mapie no_rule, jeśli na ścieżce nie ma
+ * przekierowania, a drzewo nie ma dalszego węzła zgodnego z tymi cyframi.
+ * @param[in, out] pf - wskaźnik na strukturę przekierowań;
+ * @param[in] index - numer pola.
+ */
+static void jump_fill(PhoneForward *pf, size_t index) {
+    int digits[PHFWD_JUMP_DIGITS + 1];
+    size_t rest = index;
+    for (int i = PHFWD_JUMP_DIGITS - 1; i >= 0; i--) {
+        digits[i] = (int)(rest % ALPHABET_SIZE);
+        rest /= ALPHABET_SIZE;
+    }
+
+    NodeRef current = pf->new_tree;
+    InternedString const *prefix = NULL;
+    int depth = 0;
+    int matched = 0;
+    bool dead_end = false;
+    while (depth < PHFWD_JUMP_DIGITS) {
+        NodeRef child = child_get(&fwd_node(pf, current)->children,
+                                  digits[depth]);
+        if (child == NODE_NULL) {
+            dead_end = true;
+            break;
+        }
+
+        // Krawędź dłuższą niż pozostałe cyfry porównujemy tylko na nich.
+        PhoneFWD *child_node = fwd_node(pf, child);
+        int length = child_node->label_length;
+        int fit = (length < PHFWD_JUMP_DIGITS - depth) ?
+                  length : PHFWD_JUMP_DIGITS - depth;
+        int j = 1;
+        while ((j < fit) &&
+               (conversion(child_node->label[j]) == digits[depth + j])) {
+            j++;
+        }
+        if (j < fit) {
+            dead_end = true;
+            break;
+        }
+        if (length > fit) {
+            break;
+        }
+
+        current = child;
+        depth += length;
+        if (child_node->prefix != NULL) {
+            prefix = child_node->prefix;
+            matched = depth;
+        }
     }
 
-    for (size_t j = 0; j < z + 1; j++) {
-        current_node->prefix[j] = num2[j];
+    if (depth == PHFWD_JUMP_DIGITS) {
+        int count = 0;
+        child_first(&fwd_node(pf, current)->children, &count);
+        dead_end = (count == 0);
     }
 
-    return 1;
+#ifdef PHFWD_CONCURRENT
+    // Jedyne pole tablicy to zawsze korzeń bez przekierowania.
+    (void)matched;
+#else
+    pf->jump[index] = (JumpEntry){current, prefix, (unsigned char)depth,
+                                  (unsigned char)matched};
+#endif
+
+    uint64_t bit = (uint64_t)1 << (index % 64);
+    uint64_t word = pf->no_rule[index / 64];
+    if (dead_end && (prefix == NULL)) {
+        STORE_SHARED(pf->no_rule[index / 64], word | bit);
+    }
+    else {
+        STORE_SHARED(pf->no_rule[index / 64], word & ~bit);
+    }
 }
 
 /**
- * @brief Funkcja spełnia zadanie phfwdAdd dla drzewa odwróconego.
- * @param [in, out] pf - wskaźnik na strukturę przechowującą prefiksy.
- * @param[in] num1 - wskaźnik na napis reprezentujący prefiks numerów
- *                   na które jest wykonywane przekierowanie;
- * @param[in] num2 - wskaźnik na napis reprezentujący prefiks numerów,
- *                   przekierowywanych;
- *                   
- * @return Wartość @p true, jeśli prefiksy zostały dodane.
- *         Wartość @p false, jeśli wystąpił błąd, np. podany napis nie
- *         reprezentuje numeru, oba podane numery są identyczne lub nie udało
- *         się alokować pamięci.
- */
-static bool phfwdAdd_rev_help(PhoneReversed *pf, char *num1, char *num2) {
-    PhoneReversed *current_node = pf;
-    if (pf == NULL) {
-        return 0;
+ * @brief Odświeża pola tablicy skoków numerów o danym prefiksie.
+ * Prefiksy dłuższe niż PHFWD_JUMP_DIGITS cyfr wyznaczają jedno pole.
+ * @param[in, out] pf - wskaźnik na strukturę przekierowań;
+ * @param[in] num - wskaźnik na prefiks złożony z poprawnych cyfr;
+ * @param[in] length - długość prefiksu.
+ */
+static void jump_refresh(PhoneForward *pf, char const *num, size_t length) {
+    size_t first = 0;
+    size_t count = jump_size();
+    for (size_t i = 0; (i < length) && (count > 1); i++) {
+        count /= ALPHABET_SIZE;
+        first += (size_t)conversion(num[i]) * count;
     }
 
+    for (size_t index = first; index < first + count; index++) {
+        jump_fill(pf, index);
+    }
+}
+
+/**
+ * @brief Wyznacza numer pola tablicy skoków odpowiadającego początkowi numeru.
+ * @param[in] num - wskaźnik na numer;
+ * @param[in] length - długość numeru lub NUL_TERMINATED;
+ * @param[out] index - numer pola.
+ * @return Wartość @p false, gdy numer ma mniej niż PHFWD_JUMP_DIGITS znaków
+ *         albo któryś z nich nie jest cyfrą.
+ */
+static bool jump_index(char const *num, size_t length, size_t *index) {
+    *index = 0;
+    for (int i = 0; i < PHFWD_JUMP_DIGITS; i++) {
+        int digit = digit_at(num, (size_t)i, length);
+        if (digit < 0) {
+            return false;
+        }
+        *index = *index * ALPHABET_SIZE + (size_t)digit;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Sprawdza, czy numerów pola tablicy skoków nie dotyczy żadne
+ * przekierowanie.
+ * Mapa bitowa jest o wiele mniejsza od tablicy skoków, więc zwykle leży
+ * w pamięci podręcznej procesora.
+ * @param[in] pf - wskaźnik na strukturę przekierowań;
+ * @param[in] index - numer pola.
+ * @return Wartość @p true, jeśli wynikiem jest sam numer.
+ */
+static inline bool jump_no_rule(PhoneForward const *pf, size_t index) {
+    return (LOAD_SHARED(pf->no_rule[index / 64]) >> (index % 64)) & 1;
+}
+
+/**
+ * @brief Wyznacza długość ścieżki od korzenia do węzła drzewa prefiksów.
+ * @param[in] pf - wskaźnik na strukturę przekierowań;
+ * @param[in] ref - odnośnik do węzła.
+ * @return Liczba cyfr na ścieżce.
+ */
+static size_t node_depth(PhoneForward const *pf, NodeRef ref) {
+    size_t depth = 0;
+    while (ref != pf->new_tree) {
+        PhoneFWD *node = fwd_node(pf, ref);
+        depth += node->label_length;
+        ref = node->father;
+    }
+
+    return depth;
+}
+
+/**
+ * @brief Funkcja spełnia zadanie phfwdAdd dla drzewa nieodwróconego.
+ * Schodzi po drzewie zgodnie z @p num, sprawdzając przy tym jego znaki,
+ * i tworzy brakujące węzły. Jeśli numer okaże się niepoprawny, usuwa
+ * utworzone węzły.
+ * @param [in, out] pf - wskaźnik na strukturę przechowującą przekierowania
+ *                       numerów;
+ * @param[in] num - wskaźnik na napis reprezentujący prefiks numerów
+ *                  przekierowywanych;
+ * @param[in] length - długość napisu lub NUL_TERMINATED;
+ * @param[out] size - liczba cyfr numeru.
+ * @return Odnośnik do węzła numeru lub NODE_NULL, gdy napis nie reprezentuje
+ *         numeru lub nie udało się alokować pamięci.
+ */
+static NodeRef phfwdAdd_help(PhoneForward *pf, char const *num, size_t length,
+                             size_t *size) {
+    NodeRef current = pf->new_tree;
+    PhoneFWD *current_node = fwd_node(pf, current);
+
     size_t i = 0;
-    /* Szukamy, czy w dzieciach jest już dana cyfra, jak nie, tworzymy nowego 
-    syna i jego dalej przeszukujemy */
-    while (if_correct(num1[i]) == CORRECT) {
-        if (current_node->children[conversion(num1[i])] != NULL) {
-            current_node = current_node->children[conversion(num1[i])];
+    int digit = digit_at(num, i, length);
+    /* Schodzimy po krawędziach zgodnych z num. Gdy num rozchodzi się
+    z etykietą w jej środku, dzielimy krawędź, a brakującą końcówkę num
+    zapisujemy na krawędziach nowych węzłów. */
+    while (digit >= 0) {
+        NodeRef child = child_get(&current_node->children, digit);
+        if (child == NODE_NULL) {
+            child = phfwdNew_help(pf);
+            if (child == NODE_NULL) {
+                break;
+            }
+
+            /* Węzeł wypełniamy, zanim podepniemy go do drzewa, więc inne
+            wątki widzą go od razu z całą etykietą. */
+            PhoneFWD *new_node = fwd_node(pf, child);
+            size_t first = i;
+            int first_digit = digit;
+            new_node->father = current;
+            while ((new_node->label_length < LABEL_CAPACITY) && (digit >= 0)) {
+                new_node->label[new_node->label_length++] = num[i++];
+                digit = digit_at(num, i, length);
+            }
+            if (!child_put(&current_node->children, first_digit, child)) {
+                node_pool_free(&pf->fwd_pool, child);
+                i = first;
+                digit = first_digit;
+                break;
+            }
         }
         else {
-            PhoneReversed *tmp = phfwd_rev_New_help();
-            if (tmp == NULL) {
-                return 0;
+            size_t common = label_match(fwd_node(pf, child), num + i,
+                                        length - i);
+            if (common < fwd_node(pf, child)->label_length) {
+                child = split_node(pf, child, common);
+                if (child == NODE_NULL) {
+                    break;
+                }
+            }
+            i += common;
+            digit = digit_at(num, i, length);
+        }
+        current = child;
+        current_node = fwd_node(pf, current);
+    }
+
+    if ((digit != DIGIT_END) || (i == 0)) {
+        // Wycofujemy węzły dodane dla niepoprawnego numeru.
+        if (current_node->prefix == NULL) {
+            compress_path(pf, current);
+        }
+        return NODE_NULL;
+    }
+
+    *size = i;
+    return current;
+}
+
+/**
+ * @brief Wyznacza węzeł drzewa odwróconego dla numeru.
+ * Tworzy brakujące węzły na ścieżce numeru.
+ * @param [in, out] pf - wskaźnik na strukturę przechowującą przekierowania;
+ * @param[in] target - numer, na który jest wykonywane przekierowanie.
+ * @return Odnośnik do węzła lub NODE_NULL, jeśli nie udało się alokować
+ *         pamięci.
+ */
+static NodeRef reverse_path(PhoneForward *pf, InternedString const *target) {
+    NodeRef current = pf->reversed_tree;
+
+    /* Szukamy, czy w dzieciach jest już dana cyfra, jak nie, tworzymy nowego 
+    syna i jego dalej przeszukujemy */
+    for (size_t i = 0; i < target->length; i++) {
+        int digit = string_pool_digit(target, i);
+        NodeRef child = child_get(&rev_node(pf, current)->children, digit);
+        if (child == NODE_NULL) {
+            child = phfwd_rev_New_help(pf);
+            if (child == NODE_NULL) {
+                return NODE_NULL;
             }
-            tmp->father = current_node;
-            current_node->children[conversion(num1[i])] = tmp;
-            current_node = current_node->children[conversion(num1[i])];
+            if (!child_put(&rev_node(pf, current)->children, digit, child)) {
+                node_pool_free(&pf->rev_pool, child);
+                return NODE_NULL;
+            }
+            rev_node(pf, child)->father = current;
+        }
+        current = child;
+    }
+
+    return current;
+}
+
+/**
+ * @brief Funkcja spełnia zadanie phfwdAdd dla drzewa odwróconego.
+ * @param [in, out] pf - wskaźnik na strukturę przechowującą przekierowania;
+ * @param[in] target - numer, na który jest wykonywane przekierowanie;
+ * @param[in] source - przekierowywany prefiks; odwołanie do niego przechodzi
+ *                     na drzewo odwrócone.
+ * @return Odnośnik do węzła drzewa odwróconego, do którego dodano prefiks,
+ *         lub NODE_NULL, jeśli nie udało się alokować pamięci.
+ */
+static NodeRef phfwdAdd_rev_help(PhoneForward *pf,
+                                 InternedString const *target,
+                                 InternedString const *source) {
+    NodeRef current = reverse_path(pf, target);
+    if (current == NODE_NULL) {
+        return NODE_NULL;
+    }
+    PhoneReversed *current_node = rev_node(pf, current);
+
+    // Na koniec wstawiamy prefiks, który przekierowujemy, w porządku tablicy.
+    PrefixTable *old = current_node->prefixes;
+    size_t count = (old == NULL) ? 0 : old->count;
+    size_t position = prefix_lower_bound(old, source->digits, source->length);
+    size_t size = sizeof(PrefixTable) +
+                  (count + 1) * sizeof(InternedString const*);
+#ifdef PHFWD_CONCURRENT
+    // Starą tablicę mogą czytać inne wątki, więc budujemy nową.
+    PrefixTable *table = malloc(size);
+    if (table == NULL) {
+        return NODE_NULL;
+    }
+    if (old != NULL) {
+        memcpy(table->items, old->items,
+               position * sizeof(InternedString const*));
+        memcpy(table->items + position + 1, old->items + position,
+               (count - position) * sizeof(InternedString const*));
+    }
+#else
+    PrefixTable *table = realloc(old, size);
+    if (table == NULL) {
+        return NODE_NULL;
+    }
+    memmove(table->items + position + 1, table->items + position,
+            (count - position) * sizeof(InternedString const*));
+#endif
+    table->items[position] = source;
+    table->count = count + 1;
+    if (table != old) {
+        STORE_SHARED(current_node->prefixes, table);
+#ifdef PHFWD_CONCURRENT
+        if (old != NULL) {
+            shared_free(pf, old);
+        }
+#endif
+    }
+
+    return current;
+}
+
+bool phfwdAddN(PhoneForward *pf, char const *num1, size_t length1,
+               char const *num2, size_t length2) {
+    if ((pf == NULL) || (num1 == NULL) || (num2 == NULL)) {
+        return 0;
+    }
+
+    size_t size2 = number_length(num2, 0, length2);
+    if ((size2 == NO_NUMBER) || (size2 == 0)) {
+        return 0;
+    }
+
+    // Numery są różne, gdy num1 różni się od num2 na którejś z size2 pozycji.
+    size_t i = 0;
+    while ((i < size2) && (i != length1) && (num1[i] == num2[i])) {
+        i++;
+    }
+    if ((i == size2) && (digit_at(num1, i, length1) == DIGIT_END)) {
+        return 0;
+    }
+
+    size_t size1 = 0;
+    NodeRef node = phfwdAdd_help(pf, num1, length1, &size1);
+    if (node == NODE_NULL) {
+        return 0;
+    }
+    PhoneFWD *current_node = fwd_node(pf, node);
+
+    InternedString const *target = string_pool_intern(pf->strings, num2, size2);
+    InternedString const *source = string_pool_intern(pf->strings, num1, size1);
+    if ((target == NULL) || (source == NULL)) {
+        string_pool_release(pf->strings, target);
+        string_pool_release(pf->strings, source);
+        if (current_node->prefix == NULL) {
+            compress_path(pf, node);
+        }
+        return 0;
+    }
+
+    // Przekierowanie zmienia wyniki tylko numerów o prefiksie num1.
+    if (pf->cache != NULL) {
+        number_cache_invalidate(pf->cache, num1, size1);
+    }
+
+    /* Nadpisywane przekierowanie usuwamy z drzewa odwróconego, znajdując
+    jego węzeł po odnośniku. */
+    if (current_node->reverse != NODE_NULL) {
+        remove_cell(pf, rev_node(pf, current_node->reverse), source->digits,
+                    source->length);
+    }
+    string_pool_release(pf->strings, current_node->prefix);
+    STORE_SHARED(current_node->prefix, target);
+    if (current_node->source == NULL) {
+        current_node->source = string_pool_retain(source);
+    }
+    /* Nowe węzły i przekierowanie leżą na ścieżce num1, więc mogą się
+    zmienić tylko pola numerów zaczynających się od num1. */
+    jump_refresh(pf, num1, size1);
+
+    current_node->reverse = phfwdAdd_rev_help(pf, target, source);
+    if (current_node->reverse == NODE_NULL) {
+        string_pool_release(pf->strings, source);
+        return 0;
+    }
+
+    return 1;
+}
+
+bool phfwdAdd(PhoneForward *pf, char const *num1, char const *num2) {
+    return phfwdAddN(pf, num1, NUL_TERMINATED, num2, NUL_TERMINATED);
+}
+
+/**
+ * @brief Funkcja usuwająca przekierowanie z drzewa nieodwróconego.
+ * @param[in, out] pf - wskaźnik na strukturę przekierowań;
+ * @param[in] num - wskaźnik na usuwany numer.
+ */
+static void phfwdRemove_help(PhoneForward *pf, char const *num) {
+    NodeRef current = pf->new_tree;
+    size_t i = 0;
+    /* Szukamy węzła, w którego poddrzewie są dokładnie numery o prefiksie num.
+    Jeśli num kończy się w środku krawędzi, jest nim węzeł na końcu tej
+    krawędzi. */
+    while (if_correct(num[i]) != END) {
+        NodeRef child = child_get(&fwd_node(pf, current)->children,
+                                  conversion(num[i]));
+        if (child == NODE_NULL) {
+            return;
+        }
+
+        PhoneFWD *child_node = fwd_node(pf, child);
+        size_t common = label_match(child_node, num + i, NUL_TERMINATED);
+        i += common;
+        if ((common < child_node->label_length) && (if_correct(num[i]) != END)) {
+            return;
+        }
+        current = child;
+    }
+
+    // Na koniec usuwamy całe poddrzewo i sklejamy pozostałą ścieżkę.
+    NodeRef father = fwd_node(pf, current)->father;
+    phfwdDelete_help(pf, current);
+    NodeRef kept = compress_path(pf, father);
+
+    /* Usunięte węzły leżą w poddrzewie kept, pod kolejną cyfrą num, więc
+    odświeżamy pola numerów, które mają z num wspólną ścieżkę do kept
+    i tę cyfrę. */
+    jump_refresh(pf, num, node_depth(pf, kept) + 1);
+}
+
+void phfwdRemove(PhoneForward *pf, char const *num) {
+    if ((pf != NULL) && (num != NULL) && (num[0] != '\0')
+        && (error((char*)num) != 1)) {
+        if (pf->cache != NULL) {
+            number_cache_invalidate(pf->cache, num, strlen(num));
         }
+        // Wpisy w drzewie odwróconym usuwamy razem z węzłami przekierowań.
+        phfwdRemove_help(pf, num);
+    }
+}
+
+/**
+ * @brief Wyznacza długość pozostałej części słowa.
+ * @param[in] num - wskaźnik na dany napis;
+ * @param[in] i - indeks od którego zaczynamy wyliczanie długości części słowa.
+ * @return Długość słowa.
+ */
+static size_t word_length(char *num, size_t i) {
+    while (if_correct(num[i]) == CORRECT) {
         i++;
     }
 
-    // Na koniec zapisujemy napis, na który przekierowujemy.
+    return i;
+}
+
+/**
+ * @brief Szuka najdłuższego prefiksu numeru, który ma przekierowanie.
+ * Sprawdza znaki numeru w tym samym przejściu: cyfry zgodne z etykietami
+ * są poprawne, a końcówkę numeru za ostatnim węzłem przegląda osobno.
+ * @param[in] pf - wskaźnik na strukturę przekierowań;
+ * @param[in] num - wskaźnik na numer;
+ * @param[in] length - długość numeru lub NUL_TERMINATED;
+ * @param[out] matched - długość znalezionego prefiksu lub 0;
+ * @param[out] size - liczba cyfr numeru lub NO_NUMBER, gdy napis nie
+ *                    reprezentuje numeru.
+ * @return Wskaźnik na numer, na który przekierowano prefiks, lub NULL, gdy
+ *         żaden prefiks numeru nie ma przekierowania.
+ */
+static InternedString const * find_forwarding(PhoneForward const *pf,
+                                              char const *num, size_t length,
+                                              size_t *matched, size_t *size) {
+    size_t i = 0;
+    size_t checked = 0;
+    PhoneFWD *current_node = fwd_node(pf, pf->new_tree);
+    InternedString const *prefix = NULL;
     size_t z = 0;
-    while (if_correct(num2[z]) == CORRECT) {
-        z++;
+
+    // Pierwsze cyfry numeru przeskakujemy, zaczynając od pola tablicy skoków.
+    size_t index = 0;
+    if (jump_index(num, length, &index)) {
+        if (jump_no_rule(pf, index)) {
+            *matched = 0;
+            *size = number_length(num, PHFWD_JUMP_DIGITS, length);
+            return NULL;
+        }
+
+        JumpEntry const *jump = &pf->jump[index];
+        current_node = fwd_node(pf, jump->node);
+        prefix = jump->prefix;
+        i = jump->depth;
+        z = jump->matched;
     }
 
-    size_t size = 1;
-    if (current_node->table_of_prefixes == NULL) {
-        current_node->table_of_prefixes = phnum_new_one();
-        if (current_node->table_of_prefixes == NULL) {
-            return 0;
+    // Przekierowanie węzła obowiązuje tylko po przejściu całej jego krawędzi.
+    while (true) {
+        InternedString const *node_prefix = LOAD_SHARED(current_node->prefix);
+        if (node_prefix != NULL) {
+            prefix = node_prefix;
+            z = i;
+        }
+
+        int digit = digit_at(num, i, length);
+        if (digit < 0) {
+            checked = i;
+            break;
+        }
+
+        NodeRef child = child_get(&current_node->children, digit);
+        if (child == NODE_NULL) {
+            checked = i + 1;
+            break;
+        }
+        PhoneFWD *child_node = fwd_node(pf, child);
+        size_t common = label_match(child_node, num + i, length - i);
+        if (common < child_node->label_length) {
+            checked = i + ((common == 0) ? 1 : common);
+            break;
+        }
+        current_node = child_node;
+        i += common;
+    }
+
+    *matched = z;
+    *size = number_length(num, checked, length);
+    return prefix;
+}
+
+/**
+ * @brief Szuka najdłuższego prefiksu numeru, korzystając z pamięci podręcznej.
+ * Działa tak jak find_forwarding, ale najpierw zagląda do pamięci podręcznej
+ * struktury, jeśli jest włączona, i zapamiętuje w niej nowe wyniki.
+ * @param[in] pf - wskaźnik na strukturę przekierowań;
+ * @param[in] num - wskaźnik na numer;
+ * @param[in] length - długość numeru lub NUL_TERMINATED;
+ * @param[out] matched - długość znalezionego prefiksu lub 0;
+ * @param[out] size - liczba cyfr numeru lub NO_NUMBER, gdy napis nie
+ *                    reprezentuje numeru.
+ * @return Wskaźnik na numer, na który przekierowano prefiks, lub NULL, gdy
+ *         żaden prefiks numeru nie ma przekierowania.
+ */
+static InternedString const * cached_forwarding(PhoneForward const *pf,
+                                                char const *num, size_t length,
+                                                size_t *matched, size_t *size) {
+    // Numerów, których nie dotyczy żadne przekierowanie, nie zapamiętujemy.
+    size_t index = 0;
+    if ((pf->cache == NULL) ||
+        (jump_index(num, length, &index) && jump_no_rule(pf, index))) {
+        return find_forwarding(pf, num, length, matched, size);
+    }
+
+    // Dłuższych numerów i tak nie zapamiętujemy, więc nie liczymy ich długości.
+    size_t key_length = length;
+    if (length == NUL_TERMINATED) {
+        key_length = 0;
+        while ((key_length <= NUMBER_CACHE_KEY_CAPACITY) &&
+               (num[key_length] != '\0')) {
+            key_length++;
+        }
+    }
+
+    InternedString const *prefix = NULL;
+    if (number_cache_find(pf->cache, num, key_length, &prefix, matched)) {
+        *size = key_length;
+        return prefix;
+    }
+
+    prefix = find_forwarding(pf, num, length, matched, size);
+    if ((*size != NO_NUMBER) && (*size != 0)) {
+        number_cache_insert(pf->cache, num, *size, prefix, *matched);
+    }
+
+    return prefix;
+}
+
+/**
+ * @brief Zapisuje przekierowany numer do bufora.
+ * Wynik jest zapisywany tylko w całości, razem z kończącym znakiem '\0'.
+ * @param[in] prefix - numer, na który przekierowano prefiks, lub NULL;
+ * @param[in] z - długość przekierowanego prefiksu numeru;
+ * @param[in] num - wskaźnik na poprawny numer;
+ * @param[in] num_size - liczba cyfr numeru;
+ * @param[out] out - bufor na wynik lub NULL;
+ * @param[in] capacity - rozmiar bufora.
+ * @return Długość wyniku bez kończącego znaku '\0'.
+ */
+static size_t write_forwarding(InternedString const *prefix, size_t z,
+                               char const *num, size_t num_size, char *out,
+                               size_t capacity) {
+    size_t prefix_size = (prefix == NULL) ? 0 : prefix->length;
+    size_t size = prefix_size + num_size - z;
+
+    if ((out != NULL) && (size < capacity)) {
+        if (prefix != NULL) {
+            string_pool_unpack(prefix, out);
         }
+        memcpy(out + prefix_size, num + z, num_size - z);
+        out[size] = '\0';
+    }
+
+    return size;
+}
+
+PhoneNumbers * phfwdGetN(PhoneForward const *pf, char const *num,
+                         size_t length) {
+    if (pf == NULL) {
+        return NULL;
+    }
+    if (num == NULL) {
+        return phnum_new_empty();
+    }
+
+    // Znaleziony prefiks jest ważny do końca odczytu.
+    size_t slot = read_begin(pf);
+    size_t z = 0;
+    size_t size = 0;
+    InternedString const *prefix = cached_forwarding(pf, num, length, &z,
+                                                     &size);
+    if ((size == NO_NUMBER) || (size == 0)) {
+        read_end(pf, slot);
+        return phnum_new_empty();
+    }
+
+    // Jeśli nie ma prefiksu, numer zwraca sam siebie.
+    size_t answer_size = write_forwarding(prefix, z, num, size, NULL, 0);
+    char *out = NULL;
+    PhoneNumbers *answer = phnum_new_single(answer_size, &out);
+    if (answer != NULL) {
+        write_forwarding(prefix, z, num, size, out, answer_size + 1);
+    }
+    read_end(pf, slot);
+
+    return answer;
+}
+
+PhoneNumbers * phfwdGet(PhoneForward const *pf, char const *num) {
+    return phfwdGetN(pf, num, NUL_TERMINATED);
+}
+
+size_t phfwdGetInto(PhoneForward const *pf, char const *num, char *out,
+                    size_t capacity) {
+    if ((out != NULL) && (capacity > 0)) {
+        out[0] = '\0';
+    }
+    if ((pf == NULL) || (num == NULL)) {
+        return 0;
+    }
+
+    size_t slot = read_begin(pf);
+    size_t z = 0;
+    size_t size = 0;
+    InternedString const *prefix = cached_forwarding(pf, num, NUL_TERMINATED,
+                                                     &z, &size);
+    size_t answer_size = 0;
+    if ((size != NO_NUMBER) && (size != 0)) {
+        answer_size = write_forwarding(prefix, z, num, size, out, capacity);
+    }
+    read_end(pf, slot);
+
+    return answer_size;
+}
+
+/**
+ * @brief Pobiera z wyprzedzeniem węzeł do pamięci podręcznej.
+ * @param[in] node - wskaźnik na węzeł.
+ */
+static inline void prefetch_node(void const *node) {
+#if defined(__GNUC__)
+    __builtin_prefetch(node);
+#else
+    (void)node;
+#endif
+}
+
+/**
+ * @brief To jest stan jednego wyszukiwania prowadzonego przez phfwdGetBatch.
+ */
+struct BatchLookup {
+    size_t index; ///< Numer zapytania w paczce.
+    char const *num; ///< Wskaźnik na szukany numer.
+    size_t i; ///< Liczba cyfr numeru pokrytych przez węzeł @p node.
+    size_t checked; ///< Liczba początkowych znaków numeru, o których wiadomo, że są cyframi.
+    PhoneFWD const *node; ///< Ostatni węzeł zgodny z numerem.
+    PhoneFWD const *pending; ///< Pobierany węzeł, jeszcze nieporównany z numerem.
+    InternedString const *prefix; ///< Najdłuższe dotąd znalezione przekierowanie.
+    size_t z; ///< Długość prefiksu numeru, którego dotyczy @p prefix.
+};
+/**
+ * Tworzy typ BatchLookup.
+ */
+typedef struct BatchLookup BatchLookup;
+
+/**
+ * @brief Wykonuje jeden krok wyszukiwania.
+ * Porównuje z numerem węzeł pobrany w poprzednim kroku, a następnie wybiera
+ * kolejny węzeł i zleca jego pobranie, nie czekając na nie.
+ * @param[in] pf - wskaźnik na strukturę przekierowań;
+ * @param[in, out] lookup - stan wyszukiwania.
+ * @return Wartość @p true, jeśli wyszukiwanie się zakończyło.
+ */
+static bool batch_step(PhoneForward const *pf, BatchLookup *lookup) {
+    if (lookup->pending != NULL) {
+        PhoneFWD const *child = lookup->pending;
+        lookup->pending = NULL;
+        size_t common = label_match(child, lookup->num + lookup->i,
+                                    NUL_TERMINATED);
+        if (common < child->label_length) {
+            lookup->checked = lookup->i + ((common == 0) ? 1 : common);
+            return true;
+        }
+        lookup->node = child;
+        lookup->i += child->label_length;
+    }
+
+    InternedString const *node_prefix = LOAD_SHARED(lookup->node->prefix);
+    if (node_prefix != NULL) {
+        lookup->prefix = node_prefix;
+        lookup->z = lookup->i;
+    }
+
+    int digit = digit_at(lookup->num, lookup->i, NUL_TERMINATED);
+    if (digit < 0) {
+        lookup->checked = lookup->i;
+        return true;
+    }
+
+    NodeRef child = child_get(&lookup->node->children, digit);
+    if (child == NODE_NULL) {
+        lookup->checked = lookup->i + 1;
+        return true;
+    }
+    lookup->pending = fwd_node(pf, child);
+    prefetch_node(lookup->pending);
+
+    return false;
+}
+
+void phfwdGetBatch(PhoneForward const *pf, char const * const *nums,
+                   size_t count, char * const *out, size_t capacity,
+                   size_t *lengths) {
+    BatchLookup group[BATCH_GROUP];
+    size_t active = 0;
+    size_t next = 0;
+    size_t slot = 0;
+    if (pf != NULL) {
+        slot = read_begin(pf);
+    }
+
+    /* Prowadzimy naraz do BATCH_GROUP niezależnych wyszukiwań i robimy po
+    jednym kroku każdego z nich, więc pobieranie węzła jednego wyszukiwania
+    nakłada się na kroki pozostałych. Zakończone wyszukiwanie od razu
+    zastępujemy kolejnym zapytaniem. */
+    while ((next < count) || (active > 0)) {
+        while ((active < BATCH_GROUP) && (next < count)) {
+            size_t k = next++;
+            char *buffer = (out == NULL) ? NULL : out[k];
+            if ((buffer != NULL) && (capacity > 0)) {
+                buffer[0] = '\0';
+            }
+
+            char const *num = nums[k];
+            if ((pf == NULL) || (num == NULL)) {
+                lengths[k] = 0;
+                continue;
+            }
+
+            size_t index = 0;
+            if (!jump_index(num, NUL_TERMINATED, &index)) {
+                group[active++] = (BatchLookup){k, num, 0, 0,
+                                                fwd_node(pf, pf->new_tree),
+                                                NULL, NULL, 0};
+            }
+            else if (jump_no_rule(pf, index)) {
+                size_t size = number_length(num, PHFWD_JUMP_DIGITS,
+                                            NUL_TERMINATED);
+                lengths[k] = (size == NO_NUMBER) ? 0 :
+                    write_forwarding(NULL, 0, num, size, buffer, capacity);
+            }
+            else {
+                JumpEntry const *jump = &pf->jump[index];
+                group[active++] = (BatchLookup){k, num, jump->depth, 0,
+                                                fwd_node(pf, jump->node),
+                                                NULL, jump->prefix,
+                                                jump->matched};
+            }
+        }
+
+        size_t j = 0;
+        while (j < active) {
+            BatchLookup *lookup = &group[j];
+            if (!batch_step(pf, lookup)) {
+                j++;
+                continue;
+            }
+
+            // Numer sprawdzamy do końca dopiero po zejściu z drzewa.
+            char *buffer = (out == NULL) ? NULL : out[lookup->index];
+            size_t size = number_length(lookup->num, lookup->checked,
+                                        NUL_TERMINATED);
+            lengths[lookup->index] = ((size == NO_NUMBER) || (size == 0)) ? 0 :
+                write_forwarding(lookup->prefix, lookup->z, lookup->num, size,
+                                 buffer, capacity);
+            group[j] = group[--active];
+        }
+    }
+
+    if (pf != NULL) {
+        read_end(pf, slot);
+    }
+}
+
+
+
+char const * phnumGet(PhoneNumbers const *pnum, size_t idx) {
+    if ((pnum == NULL) || (idx >= pnum->size)) {
+        return NULL;
+    }
+
+    return (char const*)pnum + pnum->offsets[idx];
+}
+
+/**
+ * @brief Porównuje numery w porządku wyników phfwdReverse.
+ * Cyfry * i # są większe od pozostałych, a numer jest mniejszy od swoich
+ * przedłużeń.
+ * @param[in] a - wskaźnik na poprawny numer;
+ * @param[in] b - wskaźnik na poprawny numer.
+ * @return Liczba ujemna, zero lub liczba dodatnia, gdy @p a jest odpowiednio
+ *         mniejszy, równy lub większy od @p b.
+ */
+static int number_compare(char const *a, char const *b) {
+    size_t i = 0;
+    while ((a[i] == b[i]) && (a[i] != '\0')) {
+        i++;
+    }
+
+    return digit_at(a, i, NUL_TERMINATED) - digit_at(b, i, NUL_TERMINATED);
+}
+
+/**
+ * @brief To jest stan scalania ciągów przez phnumMerge.
+ * Kopiec trzyma numery ciągów, które mają jeszcze niewydane numery,
+ * uporządkowane według ich najmniejszych niewydanych numerów.
+ */
+struct MergeHeap {
+    PhoneNumbers const * const *parts; ///< Scalane ciągi.
+    size_t *next; ///< Pozycja najmniejszego niewydanego numeru każdego ciągu.
+    size_t *heap; ///< Kopiec numerów ciągów.
+    size_t heap_size; ///< Liczba ciągów w kopcu.
+};
+/**
+ * Tworzy typ MergeHeap.
+ */
+typedef struct MergeHeap MergeHeap;
+
+/**
+ * @brief Porównuje najmniejsze niewydane numery dwóch ciągów.
+ * @param[in] merge - wskaźnik na stan scalania;
+ * @param[in] a - numer pierwszego ciągu;
+ * @param[in] b - numer drugiego ciągu.
+ * @return Wartość @p true, jeśli numer pierwszego ciągu jest mniejszy.
+ */
+static bool merge_less(MergeHeap const *merge, size_t a, size_t b) {
+    return number_compare(phnumGet(merge->parts[a], merge->next[a]),
+                          phnumGet(merge->parts[b], merge->next[b])) < 0;
+}
+
+/**
+ * @brief Przywraca porządek kopca ciągów od danego miejsca w dół.
+ * @param[in, out] merge - wskaźnik na stan scalania;
+ * @param[in] i - miejsce w kopcu.
+ */
+static void merge_sift_down(MergeHeap *merge, size_t i) {
+    while (true) {
+        size_t smallest = i;
+        for (size_t child = 2 * i + 1;
+             (child <= 2 * i + 2) && (child < merge->heap_size); child++) {
+            if (merge_less(merge, merge->heap[child], merge->heap[smallest])) {
+                smallest = child;
+            }
+        }
+        if (smallest == i) {
+            return;
+        }
+
+        size_t tmp = merge->heap[i];
+        merge->heap[i] = merge->heap[smallest];
+        merge->heap[smallest] = tmp;
+        i = smallest;
+    }
+}
+
+PhoneNumbers * phnumMerge(PhoneNumbers const * const *parts, size_t count,
+                          bool (*keep)(void *context, char const *num),
+                          void *context) {
+    size_t total = 0;
+    for (size_t p = 0; p < count; p++) {
+        if (parts[p] == NULL) {
+            return NULL;
+        }
+        total += parts[p]->size;
+    }
+
+    MergeHeap merge = {parts, calloc(2 * count + 1, sizeof(size_t)), NULL, 0};
+    NumbersBuilder builder;
+    if ((merge.next == NULL) || !builder_init(&builder, total, 0)) {
+        free(merge.next);
+        return NULL;
+    }
+    merge.heap = merge.next + count;
+    for (size_t p = 0; p < count; p++) {
+        if (parts[p]->size > 0) {
+            merge.heap[merge.heap_size++] = p;
+        }
+    }
+    for (size_t i = merge.heap_size / 2; i > 0; i--) {
+        merge_sift_down(&merge, i - 1);
+    }
+
+    // Numery wychodzą rosnąco, więc powtórzenia następują po sobie.
+    char const *last = NULL;
+    while (merge.heap_size > 0) {
+        size_t best = merge.heap[0];
+        char const *num = phnumGet(parts[best], merge.next[best]++);
+        if (merge.next[best] == parts[best]->size) {
+            merge.heap[0] = merge.heap[--merge.heap_size];
+        }
+        merge_sift_down(&merge, 0);
+
+        if ((last != NULL) && (number_compare(last, num) == 0)) {
+            continue;
+        }
+        last = num;
+        if ((keep == NULL) || keep(context, num)) {
+            size_t length = strlen(num);
+            char *out = builder_add(&builder, length);
+            if (out == NULL) {
+                free(merge.next);
+                return NULL;
+            }
+            memcpy(out, num, length + 1);
+        }
+    }
+
+    free(merge.next);
+    return builder_finish(&builder);
+}
+
+/**
+ * @brief Sprawdza, czy numer jest przekierowywany na dany numer.
+ * Porównuje wynik phfwdGet(x) z @p num kawałkami, bez budowania go.
+ * @param[in] pf - wskaźnik na strukturę przekierowań;
+ * @param[in] x - wskaźnik na sprawdzany numer;
+ * @param[in] num - wskaźnik na poprawny numer;
+ * @param[in] num_size - liczba cyfr @p num.
+ * @return Wartość @p true, jeśli phfwdGet(x) = num.
+ */
+static bool forwards_to(PhoneForward const *pf, char const *x, char const *num,
+                        size_t num_size) {
+    size_t z = 0;
+    size_t size = 0;
+    InternedString const *prefix = find_forwarding(pf, x, NUL_TERMINATED, &z,
+                                                   &size);
+    if ((size == NO_NUMBER) || (size == 0)) {
+        return false;
+    }
+
+    size_t prefix_size = (prefix == NULL) ? 0 : prefix->length;
+    if (prefix_size + size - z != num_size) {
+        return false;
+    }
+    for (size_t i = 0; i < prefix_size; i++) {
+        if (conversion(num[i]) != string_pool_digit(prefix, i)) {
+            return false;
+        }
+    }
+
+    return memcmp(x + z, num + prefix_size, size - z) == 0;
+}
+
+bool phfwdCacheResize(PhoneForward *pf, size_t capacity) {
+    if (pf == NULL) {
+        return false;
+    }
+
+    NumberCache *cache = NULL;
+#ifdef PHFWD_CONCURRENT
+    // Trafienia zmieniają pamięć podręczną, więc wątki czytające jej nie mają.
+    if (capacity != 0) {
+        return false;
+    }
+#endif
+    if (capacity != 0) {
+        cache = number_cache_new(capacity);
+        if (cache == NULL) {
+            return false;
+        }
+    }
+
+    number_cache_delete(pf->cache);
+    pf->cache = cache;
+
+    return true;
+}
+
+void phfwdCacheStats(PhoneForward const *pf, size_t *hits, size_t *misses) {
+    bool enabled = (pf != NULL) && (pf->cache != NULL);
+    if (hits != NULL) {
+        *hits = enabled ? pf->cache->hits : 0;
+    }
+    if (misses != NULL) {
+        *misses = enabled ? pf->cache->misses : 0;
+    }
+}
+
+/**
+ * @brief To jest kursor po numerach z jednego węzła drzewa odwróconego.
+ * Numery kursora to prefiksy z tablicy węzła, do których dopisano końcówkę
+ * szukanego numeru od pozycji @p from. Tablica jest posortowana, ale numer
+ * prefiksu, który jest początkiem następnego, może po dopisaniu końcówki
+ * trafić dalej. Takie numery kursor odkłada i wydaje dopiero wtedy, gdy są
+ * mniejsze od wszystkich numerów zaczynających się od następnego prefiksu
+ * w tablicy. Odłożone są tylko prefiksy następnego prefiksu, więc jest ich
+ * najwyżej tyle, ile cyfr ma najdłuższy prefiks.
+ */
+struct ReverseCursor {
+    InternedString const **table; ///< Posortowana tablica prefiksów węzła.
+    size_t next; ///< Indeks pierwszego nieodwiedzonego prefiksu.
+    size_t count; ///< Liczba prefiksów w tablicy.
+    size_t from; ///< Pozycja w numerze, od której zaczyna się końcówka.
+    InternedString const **pending; ///< Odłożone prefiksy, od największego numeru.
+    size_t pending_count; ///< Liczba odłożonych prefiksów.
+    size_t pending_capacity; ///< Rozmiar tablicy odłożonych prefiksów.
+    uint64_t key; ///< Klucz najmniejszego niewydanego numeru.
+};
+/**
+ * Tworzy typ ReverseCursor.
+ */
+typedef struct ReverseCursor ReverseCursor;
+
+/**
+ * @brief To jest iterator po wyniku phfwdReverse lub phfwdGetReverse.
+ * Ma po jednym kursorze na każdy węzeł ścieżki numeru w drzewie odwróconym
+ * z niepustą tablicą i jeden na sam numer. Kursory scala kopcem, a numery
+ * wyznacza dopiero wtedy, gdy są potrzebne. Z iteratora korzysta też
+ * phfwdReverse.
+ */
+struct PhoneReverseIter {
+    PhoneForward const *pf; ///< Struktura, której wynik przeglądamy.
+    char *num; ///< Kopia szukanego numeru.
+    size_t length; ///< Liczba cyfr numeru.
+    size_t count; ///< Górne ograniczenie liczby numerów.
+    bool verify; ///< Czy pomijać numery x, dla których phfwdGet(x) != num.
+    ReverseCursor *cursors; ///< Tablica kursorów.
+    size_t *heap; ///< Kopiec kursorów, które mają jeszcze numery.
+    size_t heap_size; ///< Rozmiar kopca.
+    bool failed; ///< Czy nie udało się alokować pamięci.
+    bool started; ///< Czy wydano już jakiś numer.
+    InternedString const *last_prefix; ///< Prefiks ostatnio wyznaczonego numeru.
+    size_t last_from; ///< Początek końcówki ostatnio wyznaczonego numeru.
+    uint64_t last_key; ///< Klucz ostatnio wyznaczonego numeru.
+    char *buffer; ///< Bufor na ostatnio wydany numer.
+    size_t buffer_capacity; ///< Rozmiar bufora.
+};
+
+/**
+ * @brief Udostępnia cyfrę numeru złożonego z prefiksu i końcówki numeru.
+ * @param[in] it - wskaźnik na iterator z szukanym numerem;
+ * @param[in] prefix - prefiks lub NULL, gdy jest pusty;
+ * @param[in] from - pozycja w numerze, od której zaczyna się końcówka;
+ * @param[in] j - pozycja cyfry.
+ * @return Kod cyfry lub DIGIT_END za końcem numeru.
+ */
+static int reverse_digit(PhoneReverseIter const *it,
+                         InternedString const *prefix, size_t from, size_t j) {
+    size_t prefix_size = (prefix == NULL) ? 0 : prefix->length;
+    if (j < prefix_size) {
+        return string_pool_digit(prefix, j);
+    }
+    j = j - prefix_size + from;
+
+    return (j < it->length) ? conversion(it->num[j]) : DIGIT_END;
+}
+
+/**
+ * @brief Wyznacza długość wspólnego początku dwóch prefiksów z puli.
+ * Porównuje całe bajty, czyli po dwie cyfry naraz, więc wynik jest parzysty
+ * i może być o jeden mniejszy od faktycznej długości wspólnego początku.
+ * @param[in] a - pierwszy prefiks lub NULL;
+ * @param[in] b - drugi prefiks lub NULL.
+ * @return Liczba początkowych cyfr, które na pewno są równe.
+ */
+static size_t packed_common(InternedString const *a, InternedString const *b) {
+    if ((a == NULL) || (b == NULL)) {
+        return 0;
+    }
+
+    size_t bytes = ((a->length < b->length) ? a->length : b->length) / 2;
+    size_t i = 0;
+    while ((i < bytes) && (a->digits[i] == b->digits[i])) {
+        i++;
+    }
+
+    return 2 * i;
+}
+
+/**
+ * @brief Porównuje leksykograficznie dwa numery złożone z prefiksu i końcówki.
+ * @param[in] it - wskaźnik na iterator z szukanym numerem;
+ * @param[in] a - prefiks pierwszego numeru lub NULL;
+ * @param[in] a_from - początek końcówki pierwszego numeru;
+ * @param[in] b - prefiks drugiego numeru lub NULL;
+ * @param[in] b_from - początek końcówki drugiego numeru.
+ * @return Liczba ujemna, zero lub dodatnia, gdy pierwszy numer jest
+ *         odpowiednio mniejszy, równy lub większy od drugiego.
+ */
+static int reverse_compare(PhoneReverseIter const *it,
+                           InternedString const *a, size_t a_from,
+                           InternedString const *b, size_t b_from) {
+    for (size_t j = packed_common(a, b);; j++) {
+        int x = reverse_digit(it, a, a_from, j);
+        int y = reverse_digit(it, b, b_from, j);
+        if ((x != y) || (x == DIGIT_END)) {
+            return x - y;
+        }
+    }
+}
+
+/**
+ * @brief Wyznacza klucz numeru złożonego z prefiksu i końcówki numeru.
+ * Klucz zawiera po cztery bity na każdą z REVERSE_KEY_DIGITS początkowych
+ * cyfr numeru: kod cyfry powiększony o 1 albo 0 za końcem numeru. Porządek
+ * kluczy zgadza się więc z porządkiem numerów, a równe klucze mają tylko
+ * numery o równych początkach.
+ * @param[in] it - wskaźnik na iterator z szukanym numerem;
+ * @param[in] prefix - prefiks lub NULL, gdy jest pusty;
+ * @param[in] from - pozycja w numerze, od której zaczyna się końcówka.
+ * @return Klucz numeru.
+ */
+static uint64_t reverse_key(PhoneReverseIter const *it,
+                            InternedString const *prefix, size_t from) {
+    uint64_t key = 0;
+    for (size_t j = 0; j < REVERSE_KEY_DIGITS; j++) {
+        key = (key << 4) | (uint64_t)(reverse_digit(it, prefix, from, j) + 1);
+    }
+
+    return key;
+}
+
+/**
+ * @brief Sprawdza, czy odłożony numer kursora można już wydać.
+ * Numery nieodwiedzonych prefiksów zaczynają się od następnego prefiksu
+ * w tablicy albo są większe od wszystkich numerów, które się od niego
+ * zaczynają.
+ * @param[in] it - wskaźnik na iterator z szukanym numerem;
+ * @param[in] cursor - wskaźnik na kursor z odłożonymi numerami.
+ * @return Wartość @p true, jeśli najmniejszy odłożony numer jest mniejszy od
+ *         numerów wszystkich nieodwiedzonych prefiksów.
+ */
+static bool cursor_ready(PhoneReverseIter const *it,
+                         ReverseCursor const *cursor) {
+    if (cursor->next == cursor->count) {
+        return true;
+    }
+
+    InternedString const *head = cursor->pending[cursor->pending_count - 1];
+    InternedString const *bound = cursor->table[cursor->next];
+    for (size_t j = packed_common(head, bound); j < bound->length; j++) {
+        int x = reverse_digit(it, head, cursor->from, j);
+        int y = string_pool_digit(bound, j);
+        if (x != y) {
+            return x < y;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Przesuwa kursor do jego najmniejszego niewydanego numeru.
+ * Odwiedza kolejne prefiksy tablicy, odkładając ich numery, dopóki
+ * najmniejszego z odłożonych nie można wydać.
+ * @param[in, out] it - wskaźnik na iterator z szukanym numerem; przy
+ *                      błędzie alokacji ustawia w nim @p failed;
+ * @param[in, out] cursor - wskaźnik na kursor.
+ * @return Wartość @p true, jeśli kursor ma jeszcze numer, który znajduje się
+ *         na końcu tablicy odłożonych. Wartość @p false, jeśli numery się
+ *         skończyły lub nie udało się alokować pamięci.
+ */
+static bool cursor_settle(PhoneReverseIter *it, ReverseCursor *cursor) {
+    while ((cursor->pending_count == 0) || !cursor_ready(it, cursor)) {
+        if (cursor->next == cursor->count) {
+            return false;
+        }
+
+        if (cursor->pending_count == cursor->pending_capacity) {
+            size_t capacity = 2 * cursor->pending_capacity + 1;
+            InternedString const **pending =
+                realloc(cursor->pending, capacity * sizeof(InternedString const*));
+            if (pending == NULL) {
+                it->failed = true;
+                return false;
+            }
+            cursor->pending = pending;
+            cursor->pending_capacity = capacity;
+        }
+
+        InternedString const *prefix = cursor->table[cursor->next++];
+        size_t j = cursor->pending_count;
+        while ((j > 0) &&
+               (reverse_compare(it, cursor->pending[j - 1], cursor->from,
+                                prefix, cursor->from) < 0)) {
+            cursor->pending[j] = cursor->pending[j - 1];
+            j--;
+        }
+        cursor->pending[j] = prefix;
+        cursor->pending_count++;
+    }
+
+    cursor->key = reverse_key(it, cursor->pending[cursor->pending_count - 1],
+                              cursor->from);
+    return true;
+}
+
+/**
+ * @brief Porównuje najmniejsze niewydane numery dwóch kursorów.
+ * @param[in] it - wskaźnik na iterator;
+ * @param[in] a - numer pierwszego kursora;
+ * @param[in] b - numer drugiego kursora.
+ * @return Wartość @p true, jeśli numer pierwszego kursora jest mniejszy.
+ */
+static bool cursor_less(PhoneReverseIter const *it, size_t a, size_t b) {
+    ReverseCursor const *x = &it->cursors[a];
+    ReverseCursor const *y = &it->cursors[b];
+    if (x->key != y->key) {
+        return x->key < y->key;
+    }
+
+    return reverse_compare(it, x->pending[x->pending_count - 1], x->from,
+                           y->pending[y->pending_count - 1], y->from) < 0;
+}
+
+/**
+ * @brief Przywraca porządek kopca kursorów od danego miejsca w dół.
+ * @param[in, out] it - wskaźnik na iterator;
+ * @param[in] i - miejsce w kopcu.
+ */
+static void cursor_sift_down(PhoneReverseIter *it, size_t i) {
+    while (true) {
+        size_t smallest = i;
+        for (size_t child = 2 * i + 1;
+             (child <= 2 * i + 2) && (child < it->heap_size); child++) {
+            if (cursor_less(it, it->heap[child], it->heap[smallest])) {
+                smallest = child;
+            }
+        }
+        if (smallest == i) {
+            return;
+        }
+
+        size_t tmp = it->heap[i];
+        it->heap[i] = it->heap[smallest];
+        it->heap[smallest] = tmp;
+        i = smallest;
+    }
+}
+
+/**
+ * @brief Tworzy iterator po numerach przekierowywanych na dany numer.
+ * @param[in] pf - wskaźnik na strukturę przekierowań;
+ * @param[in] num - wskaźnik na napis;
+ * @param[in] length - długość napisu lub NUL_TERMINATED;
+ * @param[in] verify - czy pomijać numery x, dla których phfwdGet(x) != num.
+ * @return Wskaźnik na iterator lub NULL, gdy nie udało się alokować pamięci
+ *         lub @p pf jest równy NULL.
+ */
+static PhoneReverseIter * reverse_iter_new(PhoneForward const *pf,
+                                           char const *num, size_t length,
+                                           bool verify) {
+    if (pf == NULL) {
+        return NULL;
+    }
+
+    PhoneReverseIter *it = calloc(1, sizeof(PhoneReverseIter));
+    if (it == NULL) {
+        return NULL;
+    }
+    it->pf = pf;
+    it->verify = verify;
+
+    length = (num == NULL) ? NO_NUMBER : number_length(num, 0, length);
+    if ((length == NO_NUMBER) || (length == 0)) {
+        // Pusty wynik: iterator bez kursorów.
+        return it;
+    }
+
+    it->num = malloc(length + 1);
+    it->cursors = calloc(length + 1, sizeof(ReverseCursor));
+    it->heap = malloc((length + 1) * sizeof(size_t));
+    if ((it->num == NULL) || (it->cursors == NULL) || (it->heap == NULL)) {
+        phfwdReverseIterDelete(it);
+        return NULL;
+    }
+    memcpy(it->num, num, length);
+    it->num[length] = '\0';
+    it->length = length;
+    it->count = 1;
+
+    // Kursor samego numeru: pusty prefiks i cały numer jako końcówka.
+    size_t cursor_count = 0;
+    ReverseCursor *cursor = &it->cursors[cursor_count++];
+    cursor->pending = malloc(sizeof(InternedString const*));
+    if (cursor->pending == NULL) {
+        phfwdReverseIterDelete(it);
+        return NULL;
+    }
+    cursor->pending[0] = NULL;
+    cursor->pending_count = 1;
+    cursor->pending_capacity = 1;
+
+    NodeRef current_ref = pf->reversed_tree;
+    for (size_t i = 0; (current_ref != NODE_NULL) && (i < length); i++) {
+        current_ref = child_get(&rev_node(pf, current_ref)->children,
+                                conversion(num[i]));
+        // Tablicę odczytujemy raz, bo wątek piszący może ją podmienić.
+        PrefixTable *table = NULL;
+        if (current_ref != NODE_NULL) {
+            table = LOAD_SHARED(rev_node(pf, current_ref)->prefixes);
+        }
+        if (table != NULL) {
+            cursor = &it->cursors[cursor_count++];
+            cursor->table = table->items;
+            cursor->count = table->count;
+            cursor->from = i + 1;
+            it->count += table->count;
+        }
+    }
+
+    for (size_t c = 0; c < cursor_count; c++) {
+        if (cursor_settle(it, &it->cursors[c])) {
+            it->heap[it->heap_size++] = c;
+        }
+    }
+    if (it->failed) {
+        phfwdReverseIterDelete(it);
+        return NULL;
+    }
+    for (size_t i = it->heap_size / 2; i-- > 0;) {
+        cursor_sift_down(it, i);
+    }
+
+    return it;
+}
+
+/**
+ * @brief Wyznacza kolejny numer iteratora bez zapisywania jego znaków.
+ * @param[in, out] it - wskaźnik na iterator;
+ * @param[out] prefix - prefiks numeru lub NULL, gdy jest pusty;
+ * @param[out] from - pozycja w szukanym numerze, od której zaczyna się
+ *                    końcówka numeru.
+ * @return Wartość @p false, jeśli numery się skończyły lub nie udało się
+ *         alokować pamięci.
+ */
+static bool reverse_iter_step(PhoneReverseIter *it,
+                              InternedString const **prefix, size_t *from) {
+    while ((it->heap_size > 0) && !it->failed) {
+        ReverseCursor *cursor = &it->cursors[it->heap[0]];
+        *prefix = cursor->pending[--cursor->pending_count];
+        *from = cursor->from;
+        uint64_t key = cursor->key;
+        if (!cursor_settle(it, cursor)) {
+            it->heap[0] = it->heap[--it->heap_size];
+        }
+        cursor_sift_down(it, 0);
+
+        // Numery wychodzą rosnąco, więc powtórzenia następują po sobie.
+        if (it->started && (it->last_key == key) &&
+            (reverse_compare(it, it->last_prefix, it->last_from,
+                             *prefix, *from) == 0)) {
+            continue;
+        }
+        it->started = true;
+        it->last_prefix = *prefix;
+        it->last_from = *from;
+        it->last_key = key;
+
+        return true;
+    }
+
+    return false;
+}
+
+PhoneReverseIter * phfwdReverseIter(PhoneForward const *pf, char const *num) {
+    return reverse_iter_new(pf, num, NUL_TERMINATED, false);
+}
+
+PhoneReverseIter * phfwdGetReverseIter(PhoneForward const *pf,
+                                       char const *num) {
+    return reverse_iter_new(pf, num, NUL_TERMINATED, true);
+}
+
+char const * phfwdReverseIterNext(PhoneReverseIter *it) {
+    if (it == NULL) {
+        return NULL;
+    }
+
+    InternedString const *prefix = NULL;
+    size_t from = 0;
+    while (reverse_iter_step(it, &prefix, &from)) {
+        size_t size = write_forwarding(prefix, from, it->num, it->length,
+                                       NULL, 0);
+        if (size + 1 > it->buffer_capacity) {
+            char *buffer = realloc(it->buffer, size + 1);
+            if (buffer == NULL) {
+                it->failed = true;
+                return NULL;
+            }
+            it->buffer = buffer;
+            it->buffer_capacity = size + 1;
+        }
+        write_forwarding(prefix, from, it->num, it->length, it->buffer,
+                         it->buffer_capacity);
+
+        if (!it->verify ||
+            forwards_to(it->pf, it->buffer, it->num, it->length)) {
+            return it->buffer;
+        }
+    }
+
+    return NULL;
+}
+
+void phfwdReverseIterDelete(PhoneReverseIter *it) {
+    if (it != NULL) {
+        if (it->cursors != NULL) {
+            for (size_t c = 0; c <= it->length; c++) {
+                free(it->cursors[c].pending);
+            }
+        }
+        free(it->cursors);
+        free(it->heap);
+        free(it->num);
+        free(it->buffer);
+        free(it);
+    }
+}
+
+/**
+ * @brief Funkcja faktycznie wykonująca operację phfwdReverse.
+ * Numery wyznacza w kolejności iteratorem i zapisuje od razu w bloku
+ * wyniku, więc wynik nie odwołuje się do struktury i pozostaje ważny po jej
+ * zmianie lub usunięciu.
+ * @param[in] pf - wskaźnik na strukturę;
+ * @param[in] num - napis, którego szukamy;
+ * @param[in] length - długość napisu lub NUL_TERMINATED;
+ * @param[in] verify - czy zostawiać tylko numery x, dla których
+ *                     phfwdGet(x) = num, tak jak phfwdGetReverse.
+ * @return Wynikowe PhoneNumbers lub NULL, gdy nie udało się alokować
+ *         pamięci.
+ */
+static PhoneNumbers * relreverse(PhoneForward const *pf, char const *num,
+                                 size_t length, bool verify) {
+    PhoneReverseIter *it = reverse_iter_new(pf, num, length, verify);
+    if (it == NULL) {
+        return NULL;
+    }
+    if (it->length == 0) {
+        phfwdReverseIterDelete(it);
+        return phnum_new_empty();
+    }
+
+    NumbersBuilder builder;
+    // Przyjmujemy, że prefiksy są mniej więcej tak długie jak numer.
+    bool built = builder_init(&builder, it->count,
+                              it->count * (it->length + 1));
+    char const *number = NULL;
+    while (built && ((number = phfwdReverseIterNext(it)) != NULL)) {
+        size_t size = strlen(number);
+        char *out = builder_add(&builder, size);
+        built = (out != NULL);
+        if (built) {
+            memcpy(out, number, size + 1);
+        }
+    }
+
+    PhoneNumbers *answer = built ? builder_finish(&builder) : NULL;
+    if (it->failed) {
+        phnumDelete(answer);
+        answer = NULL;
+    }
+    phfwdReverseIterDelete(it);
+
+    return answer;
+}
+
+PhoneNumbers * phfwdReverseN(PhoneForward const *pf, char const *num,
+                             size_t length) {
+    if (pf == NULL) {
+        return NULL;
+    }
+    if (num == NULL) {
+        return phnum_new_empty();
+    }
+
+    size_t slot = read_begin(pf);
+    PhoneNumbers *answer = relreverse(pf, num, length, false);
+    read_end(pf, slot);
+
+    return answer;
+}
+
+PhoneNumbers * phfwdReverse(PhoneForward const *pf, char const *num) {
+    return phfwdReverseN(pf, num, NUL_TERMINATED);
+}
+
+PhoneNumbers * phfwdGetReverse(PhoneForward const *pf, char const *num) {
+    if (pf == NULL) {
+        return NULL;
+    }
+    if ((num == NULL) || (num[0] == '\0') || error((char*)num)) {
+        return phnum_new_empty();
+    }
+
+    size_t slot = read_begin(pf);
+    PhoneNumbers *answer = relreverse(pf, num, NUL_TERMINATED, true);
+    read_end(pf, slot);
+
+    return answer;
+}
+
+/**
+ * @brief To jest struktura przechowująca zamrożoną kopię przekierowań.
+ * Drzewo przekierowań jest zapisane jako tablica podwójna (double-array
+ * trie) o kroku dwóch cyfr: przejście ze stanu s po parze cyfr (c1, c2)
+ * prowadzi do stanu t = base[s] + 12 * c1 + c2, o ile check[t] = s.
+ * Stany odpowiadają więc prefiksom parzystej długości. Przekierowanie
+ * z prefiksu nieparzystej długości jest zapisane w liściu osiągalnym
+ * z ostatniego stanu przed nim symbolem FROZEN_PAIRS + c1. Stanem
+ * początkowym jest 0. Wszystkie dane leżą w ciągłych tablicach, więc
+ * wyszukiwanie nie chodzi po wskaźnikach, a jego kolejne kroki zależą od
+ * siebie dwa razy rzadziej niż przy kroku jednej cyfry.
+ */
+struct PhoneForwardFrozen {
+    int32_t *base; ///< Przesunięcia przejść kolejnych stanów.
+    int32_t *check; ///< Stan, z którego prowadzi przejście do komórki, lub FROZEN_FREE.
+    uint32_t *rule; ///< Pozycja przekierowania stanu w @p targets powiększona o 1 lub 0.
+    size_t size; ///< Liczba komórek tablic.
+    char *targets; ///< Napisy przekierowań, każdy zakończony znakiem '\0'.
+    size_t targets_size; ///< Łączna długość napisów przekierowań.
+    size_t targets_capacity; ///< Rozmiar tablicy napisów przekierowań.
+};
+
+#define FROZEN_FREE (-1) ///< Wartość check wolnej komórki tablicy podwójnej.
+#define FROZEN_ROOT (-2) ///< Wartość check komórki zajętej przez stan początkowy.
+#define FROZEN_PAIRS (ALPHABET_SIZE * ALPHABET_SIZE) ///< Liczba symboli par cyfr.
+#define FROZEN_SYMBOLS (FROZEN_PAIRS + ALPHABET_SIZE) ///< Liczba wszystkich symboli przejść.
+
+/**
+ * @brief To jest element kolejki używanej przy zamrażaniu drzewa.
+ * Opisuje stan tablicy podwójnej odpowiadający miejscu w drzewie prefiksów:
+ * węzłowi i liczbie przejętych już cyfr jego etykiety. Miejsce na końcu
+ * etykiety odpowiada samemu węzłowi.
+ */
+struct FrozenItem {
+    int32_t state; ///< Numer stanu w tablicy podwójnej.
+    NodeRef node; ///< Odnośnik do węzła drzewa prefiksów.
+    unsigned char offset; ///< Liczba przejętych cyfr etykiety węzła.
+};
+/**
+ * Tworzy typ FrozenItem.
+ */
+typedef struct FrozenItem FrozenItem;
+
+/**
+ * @brief Powiększa tablice zamrożonej kopii.
+ * @param[in, out] pff - wskaźnik na zamrożoną kopię;
+ * @param[in] size - wymagana liczba komórek.
+ * @return Wartość @p false, gdy nie udało się alokować pamięci lub tablice
+ *         przekroczyłyby zakres numerów stanów.
+ */
+static bool frozen_reserve(PhoneForwardFrozen *pff, size_t size) {
+    if (size <= pff->size) {
+        return true;
+    }
+    if (size > INT32_MAX) {
+        return false;
+    }
+
+    size_t new_size = (pff->size == 0) ? 64 : pff->size;
+    while (new_size < size) {
+        new_size *= 2;
+    }
+    if (new_size > INT32_MAX) {
+        new_size = INT32_MAX;
+    }
+
+    int32_t *base = realloc(pff->base, new_size * sizeof(int32_t));
+    if (base != NULL) {
+        pff->base = base;
+    }
+    int32_t *check = realloc(pff->check, new_size * sizeof(int32_t));
+    if (check != NULL) {
+        pff->check = check;
+    }
+    uint32_t *rule = realloc(pff->rule, new_size * sizeof(uint32_t));
+    if (rule != NULL) {
+        pff->rule = rule;
+    }
+    if ((base == NULL) || (check == NULL) || (rule == NULL)) {
+        return false;
+    }
+
+    for (size_t i = pff->size; i < new_size; i++) {
+        pff->base[i] = 0;
+        pff->check[i] = FROZEN_FREE;
+        pff->rule[i] = 0;
+    }
+    pff->size = new_size;
+
+    return true;
+}
+
+/**
+ * @brief Dopisuje napis przekierowania do zamrożonej kopii.
+ * @param[in, out] pff - wskaźnik na zamrożoną kopię;
+ * @param[in] prefix - wskaźnik na numer przekierowania.
+ * @return Pozycja napisu powiększona o 1 lub 0, gdy nie udało się alokować
+ *         pamięci.
+ */
+static uint32_t frozen_add_target(PhoneForwardFrozen *pff,
+                                  InternedString const *prefix) {
+    size_t length = prefix->length + 1;
+    if (pff->targets_size + length >= UINT32_MAX) {
+        return 0;
+    }
+
+    if (pff->targets_size + length > pff->targets_capacity) {
+        size_t capacity = 2 * pff->targets_capacity + length;
+        char *targets = realloc(pff->targets, capacity);
+        if (targets == NULL) {
+            return 0;
+        }
+        pff->targets = targets;
+        pff->targets_capacity = capacity;
+    }
+
+    string_pool_unpack(prefix, pff->targets + pff->targets_size);
+    pff->targets[pff->targets_size + length - 1] = '\0';
+    pff->targets_size += length;
+
+    return (uint32_t)(pff->targets_size - length + 1);
+}
+
+/**
+ * @brief Szuka przesunięcia dla przejść ze stanu.
+ * Wyznacza najmniejsze base, dla którego wszystkie komórki base + symbol
+ * są wolne, zaczynając od miejsca @p first_free. Jeśli prawie wszystkie
+ * sprawdzone miejsca okazały się nieprzydatne, przesuwa @p first_free za
+ * nie, żeby kolejne wyszukiwania nie sprawdzały ich ponownie. Zostawia to
+ * nieliczne wolne komórki, ale chroni przed kwadratowym czasem budowy.
+ * @param[in, out] pff - wskaźnik na zamrożoną kopię;
+ * @param[in] symbols - rosnąca tablica symboli przejść;
+ * @param[in] count - liczba symboli przejść, dodatnia;
+ * @param[in, out] first_free - indeks, od którego zaczynamy szukanie.
+ * @return Znalezione przesunięcie lub -1, gdy nie udało się alokować pamięci.
+ */
+static int32_t frozen_find_base(PhoneForwardFrozen *pff, int const *symbols,
+                                int count, size_t *first_free) {
+    while ((*first_free < pff->size) &&
+           (pff->check[*first_free] != FROZEN_FREE)) {
+        (*first_free)++;
+    }
+
+    // Komórka pierwszego symbolu; base musi być dodatnie.
+    size_t position = (*first_free > (size_t)symbols[0]) ?
+                      *first_free : (size_t)symbols[0] + 1;
+    size_t useless = 0;
+    size_t scanned = 0;
+    while (true) {
+        if (!frozen_reserve(pff, position + FROZEN_SYMBOLS)) {
+            return -1;
+        }
+        scanned++;
+
+        size_t base = position - symbols[0];
+        bool fits = true;
+        for (int k = 0; (k < count) && fits; k++) {
+            fits = (pff->check[base + symbols[k]] == FROZEN_FREE);
+        }
+        if (fits) {
+            if ((scanned > 16) && (20 * useless >= 19 * scanned)) {
+                *first_free = position;
+            }
+            return (int32_t)base;
+        }
+        useless++;
+        position++;
+    }
+}
+
+/**
+ * @brief Wyznacza miejsca drzewa prefiksów o jedną cyfrę głębsze.
+ * @param[in] pf - wskaźnik na strukturę przekierowań;
+ * @param[in] item - miejsce w drzewie;
+ * @param[out] next - tablica na co najwyżej ALPHABET_SIZE miejsc;
+ * @param[out] digits - cyfry prowadzące do kolejnych miejsc.
+ * @return Liczba wyznaczonych miejsc.
+ */
+static int frozen_step(PhoneForward const *pf, FrozenItem item,
+                       FrozenItem *next, int *digits) {
+    PhoneFWD *node = fwd_node(pf, item.node);
+    if (item.offset < node->label_length) {
+        digits[0] = conversion(node->label[item.offset]);
+        next[0] = (FrozenItem){0, item.node, item.offset + 1};
+        return 1;
+    }
+
+    int count = 0;
+    for (int d = 0; d < ALPHABET_SIZE; d++) {
+        NodeRef child = child_get(&node->children, d);
+        if (child != NODE_NULL) {
+            digits[count] = d;
+            next[count] = (FrozenItem){0, child, 1};
+            count++;
+        }
+    }
+
+    return count;
+}
+
+/**
+ * @brief Podaje przekierowanie zapisane w danym miejscu drzewa prefiksów.
+ * @param[in] pf - wskaźnik na strukturę przekierowań;
+ * @param[in] item - miejsce w drzewie.
+ * @return Wskaźnik na numer przekierowania lub NULL, gdy go nie ma.
+ */
+static InternedString const * frozen_rule_at(PhoneForward const *pf,
+                                             FrozenItem item) {
+    PhoneFWD *node = fwd_node(pf, item.node);
+    return (item.offset == node->label_length) ? LOAD_SHARED(node->prefix) :
+                                                 NULL;
+}
+
+/**
+ * @brief Wypełnia zamrożoną kopię przejściami drzewa prefiksów.
+ * Przegląda drzewo wszerz, co dwie cyfry. Dla każdego stanu wyznacza
+ * przejścia po parach cyfr oraz liście z przekierowaniami z prefiksów
+ * o jedną cyfrę dłuższych.
+ * @param[in, out] pff - wskaźnik na zamrożoną kopię;
+ * @param[in] pf - wskaźnik na zamrażaną strukturę.
+ * @return Wartość @p false, gdy nie udało się alokować pamięci.
+ */
+static bool frozen_build(PhoneForwardFrozen *pff, PhoneForward const *pf) {
+    size_t capacity = 64;
+    size_t head = 0;
+    size_t tail = 0;
+    size_t first_free = 1;
+    FrozenItem *queue = malloc(capacity * sizeof(FrozenItem));
+    int *symbols = malloc(FROZEN_SYMBOLS * sizeof(int));
+    FrozenItem *next = malloc(FROZEN_PAIRS * sizeof(FrozenItem));
+    bool ok = (queue != NULL) && (symbols != NULL) && (next != NULL);
+    if (ok) {
+        queue[tail++] = (FrozenItem){0, pf->new_tree, 0};
+    }
+
+    while (ok && (head < tail)) {
+        FrozenItem item = queue[head++];
+        InternedString const *leaf_rules[ALPHABET_SIZE];
+        int leaf_symbols[ALPHABET_SIZE];
+        int pairs = 0;
+        int leaves = 0;
+
+        InternedString const *rule = frozen_rule_at(pf, item);
+        if (rule != NULL) {
+            pff->rule[item.state] = frozen_add_target(pff, rule);
+            ok = (pff->rule[item.state] != 0);
+        }
+
+        FrozenItem middle[ALPHABET_SIZE];
+        int first[ALPHABET_SIZE];
+        int middle_count = frozen_step(pf, item, middle, first);
+        for (int k = 0; k < middle_count; k++) {
+            // Liść trzyma przekierowanie z prefiksu nieparzystej długości.
+            InternedString const *odd_rule = frozen_rule_at(pf, middle[k]);
+            if (odd_rule != NULL) {
+                leaf_rules[leaves] = odd_rule;
+                leaf_symbols[leaves] = FROZEN_PAIRS + first[k];
+                leaves++;
+            }
+
+            FrozenItem last[ALPHABET_SIZE];
+            int second[ALPHABET_SIZE];
+            int last_count = frozen_step(pf, middle[k], last, second);
+            for (int l = 0; l < last_count; l++) {
+                symbols[pairs] = ALPHABET_SIZE * first[k] + second[l];
+                next[pairs] = last[l];
+                pairs++;
+            }
+        }
+
+        // Symbole liści są większe od symboli par, więc kolejność rośnie.
+        int count = pairs + leaves;
+        for (int k = 0; k < leaves; k++) {
+            symbols[pairs + k] = leaf_symbols[k];
+        }
+        if (!ok || (count == 0)) {
+            continue;
+        }
+
+        int32_t base = frozen_find_base(pff, symbols, count, &first_free);
+        if (base < 0) {
+            ok = false;
+            continue;
+        }
+        pff->base[item.state] = base;
+
+        for (int k = pairs; (k < count) && ok; k++) {
+            int32_t leaf = base + symbols[k];
+            pff->check[leaf] = item.state;
+            pff->rule[leaf] = frozen_add_target(pff, leaf_rules[k - pairs]);
+            ok = (pff->rule[leaf] != 0);
+        }
+
+        if (tail + pairs > capacity) {
+            // Zwalniamy przetworzoną część kolejki, zanim ją powiększymy.
+            memmove(queue, queue + head, (tail - head) * sizeof(FrozenItem));
+            tail -= head;
+            head = 0;
+            while (tail + pairs > capacity) {
+                capacity *= 2;
+            }
+            FrozenItem *tmp = realloc(queue, capacity * sizeof(FrozenItem));
+            if (tmp == NULL) {
+                ok = false;
+                continue;
+            }
+            queue = tmp;
+        }
+
+        for (int k = 0; k < pairs; k++) {
+            next[k].state = base + symbols[k];
+            pff->check[next[k].state] = item.state;
+            queue[tail++] = next[k];
+        }
+    }
+
+    free(queue);
+    free(symbols);
+    free(next);
+    return ok;
+}
+
+void phfwdFrozenDelete(PhoneForwardFrozen *pff) {
+    if (pff != NULL) {
+        free(pff->base);
+        free(pff->check);
+        free(pff->rule);
+        free(pff->targets);
+        free(pff);
+    }
+}
 
+PhoneForwardFrozen * phfwdFreeze(PhoneForward const *pf) {
+    if (pf == NULL) {
+        return NULL;
     }
-    else {
-        size = current_node->table_of_prefixes->size + 1;
-        current_node->table_of_prefixes->size = size;
-        current_node->table_of_prefixes->table_of_phone_numbers =
-        realloc(current_node->table_of_prefixes->table_of_phone_numbers,
-                size * (sizeof(char*)));
-        if (current_node->table_of_prefixes->table_of_phone_numbers == NULL) {
-            return NULL;
-        }
+
+    PhoneForwardFrozen *pff = calloc(1, sizeof(PhoneForwardFrozen));
+    if (pff == NULL) {
+        return NULL;
     }
 
-    char *tmp = malloc((z + 1) * sizeof(char));
-    if (tmp == NULL) {
+    if (!frozen_reserve(pff, 1 + FROZEN_SYMBOLS)) {
+        phfwdFrozenDelete(pff);
         return NULL;
     }
-    current_node->table_of_prefixes->table_of_phone_numbers[size-1] = tmp;
+    pff->check[0] = FROZEN_ROOT;
 
-    for (size_t j = 0; j < (z + 1); j++) {
-        current_node->table_of_prefixes->table_of_phone_numbers[size-1][j] = 
-        num2[j];
+    size_t slot = read_begin(pf);
+    bool built = frozen_build(pff, pf);
+    read_end(pf, slot);
+    if (!built) {
+        phfwdFrozenDelete(pff);
+        return NULL;
     }
 
-    return 1;
+    return pff;
 }
 
-bool phfwdAdd(PhoneForward *pf, char const *num1, char const *num2) {
-    /* W funkcji phfwdAdd_help wykonujemy opis phfwdAdd, ale musimy zmienić
-    dostępność napisów num1 i num2 (usuwanie stałości napisów). 
-    Wobec tego phfwdAdd jest swego rodzaju funkcją pośredniczącą. */
-    if (pf == NULL) {
-        return 0;
+PhoneNumbers * phfwdFrozenGet(PhoneForwardFrozen const *pff, char const *num) {
+    if (pff == NULL) {
+        return NULL;
     }
 
-    if (special_cases((char*)num1, (char*)num2) == 0) {
-        return 0;
+    if ((num == NULL) || (num[0] == '\0') || (error((char*)num) == 1)) {
+        return phnum_new_empty();
     }
 
-    // Musimy przekazywać wskaźnik na oba drzewa, by móc usunąć nadpisane przekierowanie z drzewa odwróconego.
-    bool odp = phfwdAdd_help(pf->new_tree, (char*)num1, (char*) num2, pf);
-    if (odp == 0) {
-        return odp;
+    size_t state = 0;
+    size_t i = 0;
+    size_t z = 0;
+    uint32_t last_rule = pff->rule[0];
+    // Idziemy po parach cyfr, po drodze sprawdzając liść po pierwszej z nich.
+    while (if_correct(num[i]) == CORRECT) {
+        size_t base = (size_t)pff->base[state];
+        int first = conversion(num[i]);
+        size_t leaf = base + FROZEN_PAIRS + first;
+        if ((pff->check[leaf] == (int32_t)state) && (pff->rule[leaf] != 0)) {
+            last_rule = pff->rule[leaf];
+            z = i + 1;
+        }
+
+        if (if_correct(num[i + 1]) != CORRECT) {
+            i++;
+            break;
+        }
+        size_t next = base + ALPHABET_SIZE * first + conversion(num[i + 1]);
+        if (pff->check[next] != (int32_t)state) {
+            break;
+        }
+        state = next;
+        i += 2;
+        if (pff->rule[state] != 0) {
+            last_rule = pff->rule[state];
+            z = i;
+        }
     }
-    else {
-        odp = phfwdAdd_rev_help(pf->reversed_tree, (char*)num2, (char*)num1);
+
+    // Jeśli nie ma prefiksu, numer zwraca sam siebie.
+    char const *prefix = (last_rule == 0) ? "" : pff->targets + last_rule - 1;
+    size_t prefix_size = strlen(prefix);
+    size_t size = word_length((char*)num, i);
+    char *out = NULL;
+    PhoneNumbers *answer = phnum_new_single(prefix_size + size - z, &out);
+    if (answer != NULL) {
+        memcpy(out, prefix, prefix_size);
+        memcpy(out + prefix_size, num + z, size - z);
+        out[prefix_size + size - z] = '\0';
     }
 
-    return odp;
+    return answer;
 }
 
 /**
- * @brief Funkcja usuwająca przekierowanie z drzewa nieodwróconego.
- * @param[in] pf - wskaźnik na drzewo.
- * @param[in] num - wskaźnik na usuwany numer.
+ * @brief To jest przekierowanie dodawane przez phfwdLoadBulk.
  */
-static void phfwdRemove_help(PhoneFWD *pf, char const *num) {
-    PhoneFWD *current_node = pf;
-    int i = 0;
-    /* W <last_node> trzymamy wskaźnik na ostatni węzeł, którego nie
-    chcemy usuwać, gdyż ma syna innego niż należący do prefiksu, lub ma 
-    przekierowanie. */
-    while ((if_correct(num[i]) != END) &&
-          (current_node->children[conversion(num[i])] != NULL)) {
-        current_node = current_node->children[conversion(num[i])];
-        i++;
-    }
-
-    if ((if_correct(num[i]) != END)) {
-        return;
-    }
+struct BulkRule {
+    char const *num1; ///< Przekierowywany prefiks.
+    char const *num2; ///< Prefiks, na który przekierowujemy.
+    size_t size1; ///< Liczba cyfr @p num1.
+    size_t size2; ///< Liczba cyfr @p num2.
+    NodeRef node; ///< Węzeł przekierowania w drzewie prefiksów lub NODE_NULL, jeśli go nie dodano.
+    NodeRef reverse; ///< Węzeł drzewa odwróconego z prefiksem @p num1 lub NODE_NULL, jeśli go nie dodano.
+    InternedString const *target; ///< Numer @p num2 z puli; odwołanie przechodzi na węzeł @p node.
+    InternedString const *source; ///< Numer @p num1 z puli; odwołanie przechodzi na węzeł @p reverse.
+    bool superseded; ///< Czy dalej w danych jest przekierowanie tego samego prefiksu.
+};
+/**
+ * Tworzy typ BulkRule.
+ */
+typedef struct BulkRule BulkRule;
 
-    // Na koniec usuwamy całe poddrzewo poniżej ostatniego elementu prefiksu.
-    phfwdDelete_help(current_node);
-}
+/**
+ * @brief To jest praca phfwdLoadBulk dla jednej pierwszej cyfry numerów.
+ * Poddrzewa cyfry, której struktura jeszcze nie ma, budujemy obok,
+ * w strukturze @p local z własnymi pulami węzłów, a potem przenosimy pule
+ * do struktury i podpinamy poddrzewa pod korzenie.
+ */
+struct BulkPart {
+    PhoneForward local; ///< Struktura budowana obok; pulę napisów dzieli ze strukturą.
+    bool forward_aside; ///< Czy poddrzewo prefiksów cyfry budujemy obok.
+    bool reverse_aside; ///< Czy poddrzewo odwrócone cyfry budujemy obok.
+    size_t forward_base; ///< Wynik node_pool_adopt dla puli drzewa prefiksów.
+    size_t reverse_base; ///< Wynik node_pool_adopt dla puli drzewa odwróconego.
+};
+/**
+ * Tworzy typ BulkPart.
+ */
+typedef struct BulkPart BulkPart;
 
 /**
- * @brief Funkcja oblicza rozmiar napisu i sprawdza jego poprawność.
- * @param[in] num - wskaźnik na napis.
- * @param[in, out] correct - indykator poprawności napisu.
- * @return Rozmiar napisu.
+ * @brief To jest praca phfwdLoadBulk dzielona między wątki.
+ * Wątki biorą kolejne zadania z licznika @p next_task. Części są
+ * rozłączne, a numery o różnych pierwszych cyfrach leżą w różnych częściach
+ * puli napisów, więc zadania nie wymagają blokad.
  */
-static size_t count_size (char *num, bool *correct) {
-    size_t size = 0;
-    while (if_correct(num[size]) == CORRECT) {
-        size++;
-    }
+struct BulkJob {
+    PhoneForward *pf; ///< Struktura, do której dodajemy przekierowania.
+    PhoneForwardRule const *input; ///< Dodawane pary.
+    BulkRule *rules; ///< Przekierowania w kolejności danych.
+    size_t count; ///< Liczba przekierowań.
+    BulkRule **forward; ///< Przekierowania podzielone według @p num1.
+    BulkRule **reverse; ///< Przekierowania podzielone według @p num2.
+    size_t forward_start[BULK_BUCKETS + 1]; ///< Początki części w @p forward.
+    size_t reverse_start[BULK_BUCKETS + 1]; ///< Początki części w @p reverse.
+    void (*task)(struct BulkJob *, size_t); ///< Funkcja wykonująca zadanie.
+    size_t task_count; ///< Liczba zadań.
+    atomic_size_t next_task; ///< Numer następnego wolnego zadania.
+    atomic_bool invalid; ///< Czy któraś para nie reprezentuje przekierowania.
+    atomic_bool failed; ///< Czy nie udało się alokować pamięci.
+    BulkPart parts[ALPHABET_SIZE]; ///< Części pracy dla kolejnych pierwszych cyfr.
+};
+/**
+ * Tworzy typ BulkJob.
+ */
+typedef struct BulkJob BulkJob;
 
-    if (if_correct(num[size]) == END) {
-        *correct = 1;
-    }
-    else {
-        *correct = 0;
-    }
+/**
+ * @brief Wyznacza część numeru.
+ * Kolejność części zgadza się z kolejnością numerów, a numer jednocyfrowy
+ * leży przed swoimi przedłużeniami.
+ * @param[in] num - wskaźnik na poprawny, niepusty numer.
+ * @return Numer części, mniejszy od BULK_BUCKETS.
+ */
+static size_t bulk_bucket(char const *num) {
+    size_t second = (num[1] == '\0') ? 0 : (size_t)conversion(num[1]) + 1;
 
-    return size;
+    return (size_t)conversion(num[0]) * (ALPHABET_SIZE + 1) + second;
 }
 
 /**
- * @brief Funkcja usuwająca przekierowanie z drzewa nieodwróconego.
- * Funkcja usuwa tylko elementy z tablic PhoneNumbers, zostawia nienaruszoną
- * strukturę ogólną drzewa.
- * @param[in] pf - wskaźnik na drzewo.
- * @param[in] num - wskaźnik na usuwany numer.
+ * @brief Sprawdza pary jednego zadania.
+ * @param[in, out] job - wskaźnik na pracę;
+ * @param[in] task - numer zadania.
  */
-static void phfwdRemove_rev_help(PhoneReversed *pf, char const *num) {
-    remove_cell(pf, (char*) num);
-
-    for (int i = 0; i < ALPHABET_SIZE; i++) {
-        if (pf->children[i] != NULL) {
-            phfwdRemove_rev_help(pf->children[i], num);
+static void bulk_check(BulkJob *job, size_t task) {
+    size_t end = (task + 1) * BULK_CHUNK;
+    if (end > job->count) {
+        end = job->count;
+    }
+
+    for (size_t i = task * BULK_CHUNK; i < end; i++) {
+        PhoneForwardRule const *pair = &job->input[i];
+        BulkRule *rule = &job->rules[i];
+        *rule = (BulkRule){pair->num1, pair->num2, 0, 0, NODE_NULL, NODE_NULL,
+                           NULL, NULL, false};
+        if ((rule->num1 != NULL) && (rule->num2 != NULL)) {
+            rule->size1 = number_length(rule->num1, 0, NUL_TERMINATED);
+            rule->size2 = number_length(rule->num2, 0, NUL_TERMINATED);
+        }
+        if ((rule->size1 == 0) || (rule->size1 == NO_NUMBER) ||
+            (rule->size2 == 0) || (rule->size2 == NO_NUMBER) ||
+            (strcmp(rule->num1, rule->num2) == 0)) {
+            atomic_store_explicit(&job->invalid, true, memory_order_relaxed);
         }
     }
 }
 
-void phfwdRemove(PhoneForward *pf, char const *num) {
-    if ((pf != NULL) && (num != NULL) && (num[0] != '\0')
-        && (error((char*)num) != 1)) {
-        phfwdRemove_help(pf->new_tree, num);
-        phfwdRemove_rev_help(pf->reversed_tree, num);
+/**
+ * @brief Porównuje przekierowania według @p num1 i kolejności w danych.
+ * @param[in] a - wskaźnik na wskaźnik na przekierowanie;
+ * @param[in] b - wskaźnik na wskaźnik na przekierowanie.
+ * @return Liczba ujemna, zero lub liczba dodatnia, gdy pierwsze
+ *         przekierowanie jest odpowiednio wcześniej, w tym samym miejscu
+ *         lub później.
+ */
+static int bulk_forward_compare(void const *a, void const *b) {
+    BulkRule const *x = *(BulkRule * const *)a;
+    BulkRule const *y = *(BulkRule * const *)b;
+    int order = number_compare(x->num1, y->num1);
+    if (order != 0) {
+        return order;
     }
+
+    // Przekierowania leżą w jednej tablicy w kolejności danych.
+    return (x > y) - (x < y);
 }
 
 /**
- * @brief Wyznacza długość pozostałej części słowa.
- * @param[in] num - wskaźnik na dany napis;
- * @param[in] i - indeks od którego zaczynamy wyliczanie długości części słowa.
- * @return Długość słowa.
+ * @brief Porównuje przekierowania według @p num2, a potem według @p num1.
+ * @param[in] a - wskaźnik na wskaźnik na przekierowanie;
+ * @param[in] b - wskaźnik na wskaźnik na przekierowanie.
+ * @return Liczba ujemna, zero lub liczba dodatnia, gdy pierwsze
+ *         przekierowanie jest odpowiednio wcześniej, w tym samym miejscu
+ *         lub później.
  */
-static size_t word_length(char *num, size_t i) {
-    while (if_correct(num[i]) == CORRECT) {
-        i++;
-    }
+static int bulk_reverse_compare(void const *a, void const *b) {
+    BulkRule const *x = *(BulkRule * const *)a;
+    BulkRule const *y = *(BulkRule * const *)b;
+    int order = number_compare(x->num2, y->num2);
 
-    return i;
+    return (order != 0) ? order : number_compare(x->num1, y->num1);
 }
 
 /**
- * @brief Funkcja sortuje bąbelkowo tablice.
- * @param[in, out] pf - wskaźnik na strukturę z tablicą.
+ * @brief Sortuje jedną część.
+ * Zadania od 0 do BULK_BUCKETS - 1 sortują części według @p num1
+ * i oznaczają przekierowania zastąpione przez późniejsze, a pozostałe
+ * sortują części według @p num2.
+ * @param[in, out] job - wskaźnik na pracę;
+ * @param[in] task - numer zadania.
  */
-static void bubble_sort(PhoneNumbers *pf) {
-    bool ok = 0;
-    while (ok == 0) {
-        ok = 1;
-        for (size_t i = 1; i < pf->size; i++) {
-            if ((pf->table_of_phone_numbers[i - 1] != NULL) &&
-                (pf->table_of_phone_numbers[i] != NULL) &&
-                (compare(pf->table_of_phone_numbers[i - 1],
-                pf->table_of_phone_numbers[i]) == -1)) {
-                char*tmp = pf->table_of_phone_numbers[i - 1];
-                pf->table_of_phone_numbers[i - 1] = pf->table_of_phone_numbers[i];
-                pf->table_of_phone_numbers[i] = tmp;
-                ok = 0;
-            }
+static void bulk_sort(BulkJob *job, size_t task) {
+    if (task >= BULK_BUCKETS) {
+        size_t bucket = task - BULK_BUCKETS;
+        size_t start = job->reverse_start[bucket];
+        qsort(job->reverse + start, job->reverse_start[bucket + 1] - start,
+              sizeof(BulkRule*), bulk_reverse_compare);
+        return;
+    }
+
+    size_t start = job->forward_start[task];
+    size_t end = job->forward_start[task + 1];
+    qsort(job->forward + start, end - start, sizeof(BulkRule*),
+          bulk_forward_compare);
+    for (size_t i = start; i + 1 < end; i++) {
+        if (strcmp(job->forward[i]->num1, job->forward[i + 1]->num1) == 0) {
+            job->forward[i]->superseded = true;
         }
     }
 }
 
 /**
- * @brief To jest funkcja alokująca PhoneNumbers o zadanej wielkości.
- * @param[in] size - rozmiar tablicy.
- * @return Zaalokowana tablica
+ * @brief Wykonuje zadania pracy, dopóki są wolne.
+ * Jest funkcją wątków phfwdLoadBulk.
+ * @param[in, out] arg - wskaźnik na pracę BulkJob.
+ * @return Wartość 0.
  */
-static PhoneNumbers * wider_allocation(size_t size) {
-    PhoneNumbers *answer = malloc(sizeof(PhoneNumbers));
-    if (answer != NULL) {
-        answer->size = size;
-        answer->table_of_phone_numbers = malloc(size * sizeof(char*));
-        if (answer->table_of_phone_numbers != NULL) {
-            for (size_t i = 0; i < size; i++) {
-                answer->table_of_phone_numbers[i] = malloc(sizeof(char));
-            }
-        }
+static int bulk_worker(void *arg) {
+    BulkJob *job = arg;
+    size_t task = atomic_fetch_add_explicit(&job->next_task, 1,
+                                            memory_order_relaxed);
+    while (task < job->task_count) {
+        job->task(job, task);
+        task = atomic_fetch_add_explicit(&job->next_task, 1,
+                                         memory_order_relaxed);
     }
 
-    return answer;
+    return 0;
 }
 
 /**
- * @brief Funkcja zlicza liczbę wszystkich prefiksów w drzewie odwróconym.
- * @param[in] current - wskaźnik na odwrócone;
- * @param[in] num - słowo, będące swoistą "mapą drzewa";
- * @param[in] max_size - największa głębokość drzewa.
- * @return Szukana liczba.
+ * @brief Wykonuje wszystkie zadania na kilku wątkach.
+ * Wątek wywołujący też wykonuje zadania. Jeśli nie uda się utworzyć
+ * któregoś wątku, zadania wykonują pozostałe.
+ * @param[in, out] job - wskaźnik na pracę;
+ * @param[in] task - funkcja wykonująca zadanie;
+ * @param[in] task_count - liczba zadań;
+ * @param[in] threads - liczba wątków razem z wywołującym.
  */
-static size_t count_how_many_cells(PhoneReversed *current, char const *num,
-                                   size_t *max_size) {
-    size_t count_cells = 0;
-    size_t i = 0;
-
-    while ((current != NULL) && (i < *max_size)) {
-        current = current->children[conversion(num[i])];
+static void bulk_run(BulkJob *job, void (*task)(BulkJob *, size_t),
+                     size_t task_count, size_t threads) {
+    job->task = task;
+    job->task_count = task_count;
+    atomic_store_explicit(&job->next_task, 0, memory_order_relaxed);
+
+    thrd_t workers[BULK_MAX_THREADS];
+    size_t started = 0;
+    while ((started + 1 < threads) && (started + 1 < task_count) &&
+           (thrd_create(&workers[started], bulk_worker, job) ==
+            thrd_success)) {
+        started++;
+    }
+    bulk_worker(job);
+    for (size_t i = 0; i < started; i++) {
+        thrd_join(workers[i], NULL);
+    }
+}
 
-        if ((current != NULL) && (current->table_of_prefixes != NULL)) {
-            count_cells += current->table_of_prefixes->size;
-        }
-        i++;
+/**
+ * @brief Dzieli przekierowania na części według pierwszych cyfr numerów.
+ * @param[in, out] job - wskaźnik na pracę ze sprawdzonymi przekierowaniami.
+ */
+static void bulk_partition(BulkJob *job) {
+    size_t forward_next[BULK_BUCKETS + 1] = {0};
+    size_t reverse_next[BULK_BUCKETS + 1] = {0};
+    for (size_t i = 0; i < job->count; i++) {
+        forward_next[bulk_bucket(job->rules[i].num1) + 1]++;
+        reverse_next[bulk_bucket(job->rules[i].num2) + 1]++;
+    }
+    for (size_t b = 0; b < BULK_BUCKETS; b++) {
+        forward_next[b + 1] += forward_next[b];
+        reverse_next[b + 1] += reverse_next[b];
     }
+    memcpy(job->forward_start, forward_next, sizeof(forward_next));
+    memcpy(job->reverse_start, reverse_next, sizeof(reverse_next));
 
-    return count_cells;
+    for (size_t i = 0; i < job->count; i++) {
+        BulkRule *rule = &job->rules[i];
+        job->forward[forward_next[bulk_bucket(rule->num1)]++] = rule;
+        job->reverse[reverse_next[bulk_bucket(rule->num2)]++] = rule;
+    }
 }
 
 /**
- * @brief Funkcja przepisuje napis na drugi.
- * @param[in] answer - PhoneNumbers zawierające tabicę;
- * @param[in] num - matryca kopiowania;
- * @param[in] count_cells - lokalizacja pierwszej tablicy;
- * @param[in] numsize - wielkość napisu;
- * @param[in] start - punkt, od którego zaczynamy przepisywanie.
+ * @brief Wyznacza początek przekierowań o danej pierwszej cyfrze.
+ * @param[in] start - początki części w tablicy przekierowań;
+ * @param[in] digit - cyfra od 0 do ALPHABET_SIZE.
+ * @return Indeks pierwszego przekierowania, którego numer zaczyna się od
+ *         cyfry @p digit lub większej.
  */
-static void string_copy(PhoneNumbers *answer, char *num, size_t count_cells,
-                        size_t numsize, size_t start) {
-    for (size_t ii = start; ii < numsize + 1; ii++) {
-        answer->table_of_phone_numbers[count_cells][ii] = num[ii];
-    }
+static size_t bulk_first(size_t const *start, size_t digit) {
+    return start[digit * (ALPHABET_SIZE + 1)];
 }
 
+/**
+ * @brief Przygotowuje strukturę, w której część buduje poddrzewa obok.
+ * Struktura ma własne, puste pule węzłów, nie ma jeszcze korzeni, a pulę
+ * napisów dzieli ze strukturą przekierowań.
+ * @param[out] local - wskaźnik na przygotowywaną strukturę;
+ * @param[in] strings - wskaźnik na pulę napisów struktury przekierowań.
+ */
+static void bulk_local_init(PhoneForward *local, StringPool *strings) {
+    node_pool_init(&local->fwd_pool, sizeof(PhoneFWD));
+    node_pool_init(&local->rev_pool, sizeof(PhoneReversed));
+    local->new_tree = NODE_NULL;
+    local->reversed_tree = NODE_NULL;
+    local->strings = strings;
+    local->cache = NULL;
+    local->jump = NULL;
+    local->no_rule = NULL;
+#ifdef PHFWD_CONCURRENT
+    local->epoch = NULL;
+#endif
+}
 
 /**
- * @brief Funkcja zliczająca powtarzające się elementy.
- * @param[in] answer - wskaźnik na strukturę z tablicą.
+ * @brief Zaczyna budowę poddrzewa obok.
+ * W wariancie PHFWD_CONCURRENT tworzy domenę epok, przez którą budowa
+ * zwalnia zastąpione kopiami węzły, tak jak w strukturze przekierowań.
+ * @param[in, out] local - wskaźnik na strukturę budowaną obok.
+ * @return Wartość @p false, gdy nie udało się alokować pamięci.
  */
-static size_t rubbish_count(PhoneNumbers* answer) {
-    size_t rubbish = 0;
+static bool bulk_aside_begin(PhoneForward *local) {
+#ifdef PHFWD_CONCURRENT
+    local->epoch = epoch_new();
+    return local->epoch != NULL;
+#else
+    (void)local;
+    return true;
+#endif
+}
 
-    for (size_t z = 0; z < answer->size - 1; z++) {
-        size_t zz = 0;
+/**
+ * @brief Kończy budowę poddrzewa obok.
+ * @param[in, out] local - wskaźnik na strukturę budowaną obok.
+ */
+static void bulk_aside_end(PhoneForward *local) {
+#ifdef PHFWD_CONCURRENT
+    // Odłożone zwolnienia oddają węzły do puli, więc wykonujemy je od razu.
+    epoch_delete(local->epoch);
+    local->epoch = NULL;
+#else
+    (void)local;
+#endif
+}
 
-        while ((if_correct(answer->table_of_phone_numbers[z][zz]) != END) && 
-               (if_correct(answer->table_of_phone_numbers[z + 1][zz]) != END) &&
-                (answer->table_of_phone_numbers[z + 1][zz] == 
-                answer->table_of_phone_numbers[z][zz])) {
-            zz++;
+/**
+ * @brief Bierze z puli numery przekierowań o jednej pierwszej cyfrze.
+ * Bierze numery @p num1 przekierowań z części drzewa prefiksów i numery
+ * @p num2 przekierowań z części drzewa odwróconego, więc zmienia tylko
+ * część puli napisów dla cyfry @p digit.
+ * @param[in, out] job - wskaźnik na pracę;
+ * @param[in] digit - pierwsza cyfra numerów.
+ */
+static void bulk_intern(BulkJob *job, size_t digit) {
+    StringPool *strings = job->pf->strings;
+    bool interned = true;
+
+    size_t end = bulk_first(job->forward_start, digit + 1);
+    for (size_t i = bulk_first(job->forward_start, digit); i < end; i++) {
+        BulkRule *rule = job->forward[i];
+        if (!rule->superseded) {
+            rule->source = string_pool_intern(strings, rule->num1,
+                                              rule->size1);
+            interned = interned && (rule->source != NULL);
         }
+    }
 
-        if (answer->table_of_phone_numbers[z + 1][zz] == 
-        answer->table_of_phone_numbers[z][zz]) {
-            rubbish++;
+    end = bulk_first(job->reverse_start, digit + 1);
+    for (size_t i = bulk_first(job->reverse_start, digit); i < end; i++) {
+        BulkRule *rule = job->reverse[i];
+        if (!rule->superseded) {
+            rule->target = string_pool_intern(strings, rule->num2,
+                                              rule->size2);
+            interned = interned && (rule->target != NULL);
         }
     }
 
-    return rubbish;
+    if (!interned) {
+        atomic_store_explicit(&job->failed, true, memory_order_relaxed);
+    }
 }
 
 /**
- * @brief Funkcja tworzy nowe, wynikowe PhoneNumbers.
- * Funkcja tworzy nową strukturę, nie zawierającą powtórzeń, zakładająć, 
- * że otrzyma posortowaną tablicę.
- * @param[in] answer - pierwotna struktura z powtórzeniami;
- * @param[in] rubbish - liczba elementów do wyrzucenia.
- * @return Wynikowa struktura.
+ * @brief Dodaje przekierowanie do drzewa prefiksów.
+ * Robi to samo co phfwdAddN poza zmianą drzewa odwróconego: nadpisywane
+ * przekierowanie usuwa z drzewa odwróconego, a nowe zostawia w @p rule.
+ * Odwołanie do @p target przechodzi na węzeł.
+ * @param[in, out] pf - wskaźnik na strukturę przekierowań;
+ * @param[in, out] rule - wskaźnik na dodawane przekierowanie z numerami
+ *                        z puli.
+ * @return Wartość @p false, gdy nie udało się alokować pamięci.
  */
-static PhoneNumbers * without_repetition(PhoneNumbers *answer, size_t rubbish) {
-    size_t i = 0;
-    bool nothing = 0; // Zmienna jest śmietnikiem dla funkcji count_size.
-
-    PhoneNumbers *new_answer = wider_allocation(answer->size - rubbish);
-    if (new_answer == NULL) {
-        return phnum_new_one();
-    }
-
-    /* Gdy występują obok siebie dwa takie same elementy, przepisujemy tylko
-    jeden z nich. */
-    for (size_t z = 0; z < answer->size - 1; z++) {
-        size_t zz = 0;
-        while ((if_correct(answer->table_of_phone_numbers[z][zz]) != END) && 
-               (if_correct(answer->table_of_phone_numbers[z + 1][zz]) != END) &&
-                (answer->table_of_phone_numbers[z + 1][zz] == 
-                answer->table_of_phone_numbers[z][zz])) {
-            zz++;
-        }
-
-        if (answer->table_of_phone_numbers[z + 1][zz]
-            != answer->table_of_phone_numbers[z][zz]) {
-            size_t stringsize = count_size(answer->table_of_phone_numbers[z],
-                                           &nothing) + 1;
-            new_answer->table_of_phone_numbers[i] = realloc
-            (new_answer->table_of_phone_numbers[i], stringsize);
-            if (new_answer->table_of_phone_numbers[i] == NULL) {
-                return NULL;
-            }
-
-            string_copy(new_answer, answer->table_of_phone_numbers[z], i, 
-                        stringsize - 1, 0);
-            i++;
-        }
+static bool bulk_add_forward(PhoneForward *pf, BulkRule *rule) {
+    size_t size = 0;
+    NodeRef node = phfwdAdd_help(pf, rule->num1, NUL_TERMINATED, &size);
+    if (node == NODE_NULL) {
+        return false;
     }
+    PhoneFWD *current_node = fwd_node(pf, node);
 
-    /* Na koniec dopisujemy ostatni element, którego nie mieliśmy jak wpisać
-    po porównaniu. */
-    if (i != new_answer->size) {
-        size_t stringsize = count_size(answer->table_of_phone_numbers
-                                       [answer->size - 1], &nothing) + 1;
-        new_answer->table_of_phone_numbers[i] = 
-        realloc(new_answer->table_of_phone_numbers[i], stringsize);
-        if (new_answer->table_of_phone_numbers[i] == NULL) {
-            return NULL;
-        }
-
-        string_copy(new_answer, answer->table_of_phone_numbers[answer->size-1], 
-                    i, stringsize - 1, 0);
+    if (current_node->reverse != NODE_NULL) {
+        remove_cell(pf, rev_node(pf, current_node->reverse),
+                    rule->source->digits, rule->source->length);
+        current_node->reverse = NODE_NULL;
+    }
+    string_pool_release(pf->strings, current_node->prefix);
+    STORE_SHARED(current_node->prefix, rule->target);
+    if (current_node->source == NULL) {
+        current_node->source = string_pool_retain(rule->source);
     }
 
-    phnumDelete(answer);
-    return new_answer;
+    rule->node = node;
+    return true;
 }
 
 /**
- * @brief Funkcja faktycznie wykonująca operację phfwdReverse.
- * @param[in] pf - wskaźnik na strukturę;
- * @param[in] num - napis, którego szukamy;
- * @param[in] max_size - maksymalny rozmiar tablicy.
- * @return Wynikowe PhoneNumbers.
+ * @brief Dodaje do drzewa prefiksów przekierowania o jednej pierwszej cyfrze.
+ * @param[in, out] job - wskaźnik na pracę;
+ * @param[in, out] pf - wskaźnik na strukturę, do której dodajemy: strukturę
+ *                      przekierowań lub strukturę budowaną obok;
+ * @param[in] digit - pierwsza cyfra numerów @p num1.
  */
-static PhoneNumbers * relreverse(const PhoneForward *pf, char const *num,
-                                size_t max_size) {
-    PhoneReversed *current = pf->reversed_tree;
-    size_t count_cells = count_how_many_cells(current, num, &max_size) + 1;
-    // Dodajemy przestrzeń na ten sam numer.
-    PhoneNumbers *answer = wider_allocation(count_cells);
+static void bulk_forward_part(BulkJob *job, PhoneForward *pf, size_t digit) {
+    size_t start = bulk_first(job->forward_start, digit);
+    size_t end = bulk_first(job->forward_start, digit + 1);
+    bool added = true;
+    for (size_t i = start; i < end; i++) {
+        BulkRule *rule = job->forward[i];
+        if (!rule->superseded && (rule->target != NULL) &&
+            (rule->source != NULL) && !bulk_add_forward(pf, rule)) {
+            added = false;
+        }
+    }
 
-    size_t i = 0;
-    count_cells = 0;
-    bool nothing = 0; // Zmienna jest śmietnikiem dla funkcji count_size.
-    size_t numsize = count_size((char*)num, &nothing);
-    answer->table_of_phone_numbers[count_cells] = 
-    realloc(answer->table_of_phone_numbers[count_cells], numsize + 1);
-    if (answer->table_of_phone_numbers[count_cells] == NULL) {
-        return NULL;
+#ifdef PHFWD_CONCURRENT
+    /* Późniejsze przekierowanie mogło podzielić krawędź węzła, który
+    zastąpiła wtedy kopia, więc szukamy węzłów od nowa. */
+    for (size_t i = start; i < end; i++) {
+        BulkRule *rule = job->forward[i];
+        if (rule->node != NODE_NULL) {
+            size_t size = 0;
+            rule->node = phfwdAdd_help(pf, rule->num1, NUL_TERMINATED, &size);
+        }
     }
+#endif
 
-    string_copy(answer, (char*) num, count_cells, numsize, 0);
-    count_cells++;
-    current = pf->reversed_tree;
-
-    /* Główna pętla funkcji. Przechodzimy po tablicach, sklejamy je ze sobą
-    i dodajemy adekwatne końcówki (z num). */    
-    while ((current != NULL) && (i < max_size)) {
-            current = current->children[conversion(num[i])];
-        if ((current != NULL) && (current->table_of_prefixes != NULL)) {
-            for (size_t z = 0; z < current->table_of_prefixes->size; z++) {
-                size_t string_size = count_size
-                (current->table_of_prefixes->table_of_phone_numbers[z],
-                &nothing);
-
-                answer->table_of_phone_numbers[count_cells] =
-                realloc (answer->table_of_phone_numbers[count_cells], 
-                         string_size + numsize - i);
-                if (answer->table_of_phone_numbers[count_cells] == NULL) {
-                    return NULL;
-                }
+    if (!added) {
+        atomic_store_explicit(&job->failed, true, memory_order_relaxed);
+    }
+}
 
-                string_copy(answer, 
-                            current->table_of_prefixes->table_of_phone_numbers[z], 
-                            count_cells, string_size, 0);
+/**
+ * @brief Buduje obok poddrzewo prefiksów jednej pierwszej cyfry.
+ * Jeśli nie uda się zacząć budowy, zostawia przekierowania wątkowi
+ * wywołującemu.
+ * @param[in, out] job - wskaźnik na pracę;
+ * @param[in] digit - pierwsza cyfra numerów @p num1.
+ */
+static void bulk_forward_aside(BulkJob *job, size_t digit) {
+    BulkPart *part = &job->parts[digit];
+    if (!part->forward_aside) {
+        return;
+    }
 
-                size_t jj = i + 1;
-                for (size_t ii = string_size; ii < (numsize - i + string_size); ii++) {
-                    answer->table_of_phone_numbers[count_cells][ii] = num[jj];
-                    jj++;
-                }
-                count_cells++;
-            }
+    PhoneForward *local = &part->local;
+    if (bulk_aside_begin(local)) {
+        local->new_tree = phfwdNew_help(local);
+        if (local->new_tree != NODE_NULL) {
+            bulk_forward_part(job, local, digit);
         }
-        i++;
     }
+    bulk_aside_end(local);
 
-    bubble_sort(answer);
-    size_t rubbish = rubbish_count(answer);
-    if (rubbish != 0) {
-       return without_repetition(answer, rubbish);
+    if (local->new_tree == NODE_NULL) {
+        node_pool_destroy(&local->fwd_pool, release_fwd_node);
+        part->forward_aside = false;
     }
+}
 
-    return answer;
+/**
+ * @brief Oddaje przekierowaniom numery z ich węzłów drzewa prefiksów.
+ * Po niej poddrzewo cyfry nie trzyma żadnych napisów i można je porzucić.
+ * @param[in, out] job - wskaźnik na pracę;
+ * @param[in, out] pf - wskaźnik na strukturę z poddrzewem;
+ * @param[in] digit - pierwsza cyfra numerów @p num1.
+ */
+static void bulk_forget_forward(BulkJob *job, PhoneForward *pf, size_t digit) {
+    size_t end = bulk_first(job->forward_start, digit + 1);
+    for (size_t i = bulk_first(job->forward_start, digit); i < end; i++) {
+        BulkRule *rule = job->forward[i];
+        if (rule->node != NODE_NULL) {
+            PhoneFWD *node = fwd_node(pf, rule->node);
+            string_pool_release(pf->strings, node->source);
+            node->source = NULL;
+            node->prefix = NULL;
+            rule->node = NODE_NULL;
+        }
+    }
+    atomic_store_explicit(&job->failed, true, memory_order_relaxed);
 }
 
-PhoneNumbers * phfwdReverse(PhoneForward const *pf, char const *num) {
-    // Przechodzimy drzewo pierwszy raz i zliczamy prefiksty.
-    if (pf == NULL) {
-        return NULL;
+#ifdef PHFWD_INDEX_NODES
+/**
+ * @brief Przenumerowuje odnośniki zbioru dzieci przeniesionego węzła.
+ * @param[in, out] set - wskaźnik na zbiór dzieci;
+ * @param[in] base - wynik node_pool_adopt.
+ */
+static void child_rebase(ChildSet *set, size_t base) {
+#ifdef PHFWD_COMPACT_NODES
+    for (int i = 0; i < popcount(set->bitmap); i++) {
+        set->dense[i] = node_pool_rebase(set->dense[i], base);
     }
-    if ((num == NULL) || (error((char*) num) == 1) || (num[0] == '\0')) {
-        return phnum_new_one();
+#else
+    for (int i = 0; i < ALPHABET_SIZE; i++) {
+        set->slots[i] = node_pool_rebase(set->slots[i], base);
     }
+#endif
+}
 
-    PhoneReversed *current = pf->reversed_tree;
-    bool correct = 0;
-
-    size_t max_size = count_size((char*)num, &correct);
+/**
+ * @brief Przenumerowuje przeniesione poddrzewo prefiksów jednej cyfry.
+ * Obchodzi drzewo bez stosu, wracając po ojcach.
+ * @param[in, out] job - wskaźnik na pracę;
+ * @param[in] digit - pierwsza cyfra numerów @p num1.
+ */
+static void bulk_rebase_forward(BulkJob *job, size_t digit) {
+    BulkPart *part = &job->parts[digit];
+    if (!part->forward_aside) {
+        return;
+    }
 
-    if (correct && current != NULL) {
-       return relreverse(pf, (char*) num, max_size);
+    PhoneForward *pf = job->pf;
+    size_t base = part->forward_base;
+    NodeRef root = node_pool_rebase(part->local.new_tree, base);
+    NodeRef current = root;
+    while (current != NODE_NULL) {
+        PhoneFWD *node = fwd_node(pf, current);
+        child_rebase(&node->children, base);
+        node->father = node_pool_rebase(node->father, base);
+
+        NodeRef next = child_first(&node->children, NULL);
+        while ((next == NODE_NULL) && (current != root)) {
+            node = fwd_node(pf, current);
+            next = child_after(&fwd_node(pf, node->father)->children,
+                               conversion(node->label[0]));
+            current = node->father;
+        }
+        current = next;
     }
-    else {
-        return phnum_new_one();
+
+    size_t end = bulk_first(job->forward_start, digit + 1);
+    for (size_t i = bulk_first(job->forward_start, digit); i < end; i++) {
+        BulkRule *rule = job->forward[i];
+        rule->node = node_pool_rebase(rule->node, base);
     }
 }
-
+#endif
 
 /**
- * @brief Okeśla PhoneNumbers zwracane przez phfwdGet w szczególnym przypadku.
- * Funkcja wyznacza wynik phfwdGet w przypadku, gdy napis nie ma przekierowania 
- * i tablica powinna zawierać wyjściowy numer.
- * @param[in, out] new - wskaźnik na strukturę;
- * @param[in] num - wskaźnik na wyjściowy napis;
- * @param[in] size - wielkość wyjściowego napisu.
- * @return Struktura zawierająca wyjściowy napis.
+ * @brief Przenosi do struktury poddrzewa prefiksów zbudowane obok.
+ * Przy braku pamięci porzuca poddrzewa, a ich przekierowania zostają
+ * niedodane.
+ * @param[in, out] job - wskaźnik na pracę;
+ * @param[in] threads - liczba wątków.
  */
-static PhoneNumbers *same_number(PhoneNumbers *new, char *num, size_t size) {
-    char *tmp = realloc(new->table_of_phone_numbers[0], (size_t) (size + 1));
-    if (tmp == NULL) {
-        return NULL;
+static void bulk_graft_forward(BulkJob *job, size_t threads) {
+    PhoneForward *pf = job->pf;
+    size_t slabs = 0;
+    for (size_t d = 0; d < ALPHABET_SIZE; d++) {
+        if (job->parts[d].forward_aside) {
+            slabs += job->parts[d].local.fwd_pool.slab_count;
+        }
     }
-    new->table_of_phone_numbers[0] = tmp;
 
-    for (size_t i = 0; i < (size + 1); i++) {
-        new->table_of_phone_numbers[0][i] = num[i];
+    bool reserved = node_pool_reserve(&pf->fwd_pool, slabs);
+    for (size_t d = 0; d < ALPHABET_SIZE; d++) {
+        BulkPart *part = &job->parts[d];
+        if (part->forward_aside && reserved) {
+            part->forward_base = node_pool_adopt(&pf->fwd_pool,
+                                                 &part->local.fwd_pool);
+        }
+        else if (part->forward_aside) {
+            bulk_forget_forward(job, &part->local, d);
+            node_pool_destroy(&part->local.fwd_pool, release_fwd_node);
+            part->forward_aside = false;
+        }
     }
+#ifdef PHFWD_INDEX_NODES
+    bulk_run(job, bulk_rebase_forward, ALPHABET_SIZE, threads);
+#else
+    (void)threads;
+#endif
+
+    PhoneFWD *tree = fwd_node(pf, pf->new_tree);
+    for (size_t d = 0; d < ALPHABET_SIZE; d++) {
+        BulkPart *part = &job->parts[d];
+        if (!part->forward_aside) {
+            continue;
+        }
 
-    return new;
+        // Korzeń budowy obok nie trafia do drzewa, tylko jego jedyne dziecko.
+        NodeRef root = node_pool_rebase(part->local.new_tree,
+                                        part->forward_base);
+        NodeRef top = child_get(&fwd_node(pf, root)->children, (int)d);
+        child_clear(&fwd_node(pf, root)->children);
+        node_pool_free(&pf->fwd_pool, root);
+        if (top != NODE_NULL) {
+            fwd_node(pf, top)->father = pf->new_tree;
+            // Niepodpięte poddrzewo zostaje w puli do usunięcia struktury.
+            if (!child_put(&tree->children, (int)d, top)) {
+                bulk_forget_forward(job, pf, d);
+            }
+        }
+    }
 }
 
 /**
- * @brief Okeśla PhoneNumbers zwracane przez phfwdGet w ogólnym przypadku.
- * @param[in, out] new - wskaźnik na zwracaną strukturę;
- * @param[in] last_prefix - wskaźnik na węzeł z ostatnim przekierowaniem;
- * @param[in] previous_size - rozmiar pierwotnego numeru;
- * @param[in] prefix_size - rozmiar napisu reprezentującego nowy prefiks;
- * @param[in] to_subtract - rozmiar części numeru, która jest podmieniana
- *                          na nowy prefiks;
- * @param[in] num - wskaźnik na wejściowy numer.
- * @return Struktura zawierająca nowy, przekierowany numer.
+ * @brief Dodaje do drzewa odwróconego przekierowania na jeden numer.
+ * Tablicę prefiksów węzła numeru powiększa jeden raz i scala z nią
+ * posortowane prefiksy przekierowań. Odwołania do prefiksów przechodzą na
+ * węzeł, który zapisuje w przekierowaniach.
+ * @param[in, out] pf - wskaźnik na strukturę przekierowań;
+ * @param[in] group - przekierowania na ten sam numer, posortowane według
+ *                    @p num1;
+ * @param[in] count - liczba przekierowań.
+ * @return Wartość @p false, gdy nie udało się alokować pamięci.
  */
-static PhoneNumbers * new_number(PhoneNumbers *new, PhoneFWD *last_prefix,
-                                size_t previous_size, size_t prefix_size,
-                                size_t to_subtract, char *num){
-    size_t size = previous_size + prefix_size - to_subtract + 1;
-    char *tmp = realloc(new->table_of_phone_numbers[0], (size_t) size);
-    if (tmp == NULL) {
-        return NULL;
+static bool bulk_add_reverse(PhoneForward *pf, BulkRule * const *group,
+                             size_t count) {
+    NodeRef current = reverse_path(pf, group[0]->target);
+    PrefixTable *old = NULL;
+    PrefixTable *table = NULL;
+    size_t kept = 0;
+    if (current != NODE_NULL) {
+        old = rev_node(pf, current)->prefixes;
+        kept = (old == NULL) ? 0 : old->count;
+        size_t size = sizeof(PrefixTable) +
+                      (kept + count) * sizeof(InternedString const*);
+#ifdef PHFWD_CONCURRENT
+        // Starą tablicę mogą czytać inne wątki, więc scalamy w nowej.
+        table = malloc(size);
+        if ((table != NULL) && (old != NULL)) {
+            memcpy(table->items, old->items,
+                   kept * sizeof(InternedString const*));
+        }
+#else
+        table = realloc(old, size);
+#endif
     }
-    new->table_of_phone_numbers[0] = tmp;
-
-    size_t i = 0;
-    while (i < prefix_size) {
-        new->table_of_phone_numbers[0][i] = last_prefix->prefix[i];
-        i++;
+    if (table == NULL) {
+        return false;
     }
 
-    while (i < size - 1) {
-        new->table_of_phone_numbers[0][i] = num[to_subtract];
-        to_subtract++;
-        i++;
+    // Scalamy od końca, więc nowe prefiksy nie nadpisują starych.
+    size_t i = kept;
+    size_t j = count;
+    while (j > 0) {
+        InternedString const *source = group[j - 1]->source;
+        if ((i > 0) && (string_pool_compare(table->items[i - 1],
+                                            source->digits,
+                                            source->length) > 0)) {
+            i--;
+            table->items[i + j] = table->items[i];
+        }
+        else {
+            j--;
+            table->items[i + j] = source;
+        }
+    }
+    table->count = kept + count;
+    if (table != old) {
+        STORE_SHARED(rev_node(pf, current)->prefixes, table);
+#ifdef PHFWD_CONCURRENT
+        if (old != NULL) {
+            shared_free(pf, old);
+        }
+#endif
     }
 
-    new->table_of_phone_numbers[0][i] = '\0';
+    for (size_t k = 0; k < count; k++) {
+        group[k]->reverse = current;
+    }
 
-    return new;
+    return true;
 }
 
-PhoneNumbers * phfwdGet(PhoneForward const *pf, char const *num) {
-    if (pf == NULL) {
-        return NULL;
+/**
+ * @brief Dodaje do drzewa odwróconego przekierowania na numery o jednej
+ * pierwszej cyfrze.
+ * Dodaje tylko przekierowania dodane do drzewa prefiksów.
+ * @param[in, out] job - wskaźnik na pracę;
+ * @param[in, out] pf - wskaźnik na strukturę, do której dodajemy: strukturę
+ *                      przekierowań lub strukturę budowaną obok;
+ * @param[in] digit - pierwsza cyfra numerów @p num2.
+ */
+static void bulk_reverse_part(BulkJob *job, PhoneForward *pf, size_t digit) {
+    size_t start = bulk_first(job->reverse_start, digit);
+    size_t end = bulk_first(job->reverse_start, digit + 1);
+
+    // Dodane przekierowania przesuwamy w kolejności na początek części.
+    size_t kept = start;
+    for (size_t i = start; i < end; i++) {
+        if (job->reverse[i]->node != NODE_NULL) {
+            BulkRule *rule = job->reverse[i];
+            job->reverse[i] = job->reverse[kept];
+            job->reverse[kept++] = rule;
+        }
     }
 
-    PhoneNumbers *new = phnum_new_one();
-    if ((new == NULL) || (new->table_of_phone_numbers == NULL)) {
-        return NULL;
+    // Równe numery leżą obok siebie.
+    bool added = true;
+    while ((start < kept) && added) {
+        size_t group_end = start + 1;
+        while ((group_end < kept) &&
+               (job->reverse[group_end]->target ==
+                job->reverse[start]->target)) {
+            group_end++;
+        }
+        added = bulk_add_reverse(pf, job->reverse + start, group_end - start);
+        start = group_end;
     }
 
-    if ((num == NULL) || (num[0] == '\0') || (error((char*)num) == 1)) {
-        return new;
+    if (!added) {
+        atomic_store_explicit(&job->failed, true, memory_order_relaxed);
     }
+}
 
-    size_t j = 0;
-    size_t i = 0;
-    PhoneFWD *current_node = (PhoneFWD*)pf->new_tree;
-    PhoneFWD *last_prefix = NULL;
-    size_t z = 0;
-    while ((if_correct(num[i]) == CORRECT) && 
-           (current_node->children[conversion(num[i])] != NULL)) {
-        if (current_node->prefix != NULL) {
-            last_prefix = current_node;
-            z = i;
-        }
-        current_node = current_node->children[conversion(num[i])];
-        i++;
+/**
+ * @brief Buduje obok poddrzewo odwrócone jednej pierwszej cyfry.
+ * Jeśli nie uda się zacząć budowy, zostawia przekierowania wątkowi
+ * wywołującemu.
+ * @param[in, out] job - wskaźnik na pracę;
+ * @param[in] digit - pierwsza cyfra numerów @p num2.
+ */
+static void bulk_reverse_aside(BulkJob *job, size_t digit) {
+    BulkPart *part = &job->parts[digit];
+    if (!part->reverse_aside) {
+        return;
     }
 
-    if (current_node->prefix != NULL) {
-        last_prefix = current_node;
-        z = i;
+    PhoneForward *local = &part->local;
+    if (bulk_aside_begin(local)) {
+        local->reversed_tree = phfwd_rev_New_help(local);
+        if (local->reversed_tree != NODE_NULL) {
+            bulk_reverse_part(job, local, digit);
+        }
     }
+    bulk_aside_end(local);
 
-    // Jeśli nie ma prefiksu, numer zwraca sam siebie.
-    if (last_prefix == NULL) {
-       return same_number(new, (char*)num, word_length((char*)num, i));
+    if (local->reversed_tree == NODE_NULL) {
+        node_pool_destroy(&local->rev_pool, release_rev_node);
+        part->reverse_aside = false;
     }
+}
 
-    return new_number(new, last_prefix, word_length((char*)num, i),
-                      word_length(last_prefix->prefix, j), z, (char*)num);
+/**
+ * @brief Oddaje przekierowaniom prefiksy z ich węzłów drzewa odwróconego.
+ * Po niej poddrzewo cyfry nie jest potrzebne i można je porzucić.
+ * @param[in, out] job - wskaźnik na pracę;
+ * @param[in] digit - pierwsza cyfra numerów @p num2.
+ */
+static void bulk_forget_reverse(BulkJob *job, size_t digit) {
+    size_t end = bulk_first(job->reverse_start, digit + 1);
+    for (size_t i = bulk_first(job->reverse_start, digit); i < end; i++) {
+        BulkRule *rule = job->reverse[i];
+        if (rule->reverse != NODE_NULL) {
+            fwd_node(job->pf, rule->node)->reverse = NODE_NULL;
+            rule->reverse = NODE_NULL;
+        }
+    }
+    atomic_store_explicit(&job->failed, true, memory_order_relaxed);
 }
 
+/**
+ * @brief Zapisuje w węzłach drzewa prefiksów ich węzły drzewa odwróconego.
+ * Przeniesione poddrzewo odwrócone cyfry najpierw przenumerowuje.
+ * @param[in, out] job - wskaźnik na pracę;
+ * @param[in] digit - pierwsza cyfra numerów @p num2.
+ */
+static void bulk_link(BulkJob *job, size_t digit) {
+    PhoneForward *pf = job->pf;
+    BulkPart *part = &job->parts[digit];
+    size_t base = part->reverse_aside ? part->reverse_base : 0;
+#ifdef PHFWD_INDEX_NODES
+    if (part->reverse_aside) {
+        // Obchodzimy drzewo bez stosu, wracając po ojcach.
+        NodeRef root = node_pool_rebase(part->local.reversed_tree, base);
+        NodeRef current = root;
+        while (current != NODE_NULL) {
+            PhoneReversed *node = rev_node(pf, current);
+            child_rebase(&node->children, base);
+            node->father = node_pool_rebase(node->father, base);
+
+            NodeRef next = child_first(&node->children, NULL);
+            while ((next == NODE_NULL) && (current != root)) {
+                NodeRef father = rev_node(pf, current)->father;
+                ChildSet const *siblings = &rev_node(pf, father)->children;
+                int position = 0;
+                while (child_get(siblings, position) != current) {
+                    position++;
+                }
+                next = child_after(siblings, position);
+                current = father;
+            }
+            current = next;
+        }
+    }
+#endif
 
+    size_t end = bulk_first(job->reverse_start, digit + 1);
+    for (size_t i = bulk_first(job->reverse_start, digit); i < end; i++) {
+        BulkRule *rule = job->reverse[i];
+        if (rule->reverse != NODE_NULL) {
+            rule->reverse = node_pool_rebase(rule->reverse, base);
+            fwd_node(pf, rule->node)->reverse = rule->reverse;
+        }
+    }
+}
 
-char const * phnumGet(PhoneNumbers const *pnum, size_t idx) {
-    if (pnum != NULL) {
-        if ((pnum->table_of_phone_numbers != NULL) && (idx < (pnum->size))) {
-            return pnum->table_of_phone_numbers[idx];
+/**
+ * @brief Przenosi do struktury poddrzewa odwrócone zbudowane obok.
+ * Przy braku pamięci porzuca poddrzewa, a ich przekierowania zostają bez
+ * wpisu w drzewie odwróconym.
+ * @param[in, out] job - wskaźnik na pracę;
+ * @param[in] threads - liczba wątków.
+ */
+static void bulk_graft_reverse(BulkJob *job, size_t threads) {
+    PhoneForward *pf = job->pf;
+    size_t slabs = 0;
+    for (size_t d = 0; d < ALPHABET_SIZE; d++) {
+        if (job->parts[d].reverse_aside) {
+            slabs += job->parts[d].local.rev_pool.slab_count;
         }
-        else {
-            return NULL;
+    }
+
+    bool reserved = node_pool_reserve(&pf->rev_pool, slabs);
+    for (size_t d = 0; d < ALPHABET_SIZE; d++) {
+        BulkPart *part = &job->parts[d];
+        if (part->reverse_aside && reserved) {
+            part->reverse_base = node_pool_adopt(&pf->rev_pool,
+                                                 &part->local.rev_pool);
+        }
+        else if (part->reverse_aside) {
+            bulk_forget_reverse(job, d);
+            node_pool_destroy(&part->local.rev_pool, release_rev_node);
+            part->reverse_aside = false;
         }
     }
-    else {
-        return NULL;
+    bulk_run(job, bulk_link, ALPHABET_SIZE, threads);
+
+    PhoneReversed *tree = rev_node(pf, pf->reversed_tree);
+    for (size_t d = 0; d < ALPHABET_SIZE; d++) {
+        BulkPart *part = &job->parts[d];
+        if (!part->reverse_aside) {
+            continue;
+        }
+
+        NodeRef root = node_pool_rebase(part->local.reversed_tree,
+                                        part->reverse_base);
+        NodeRef top = child_get(&rev_node(pf, root)->children, (int)d);
+        child_clear(&rev_node(pf, root)->children);
+        node_pool_free(&pf->rev_pool, root);
+        if (top != NODE_NULL) {
+            rev_node(pf, top)->father = pf->reversed_tree;
+            // Niepodpięte poddrzewo zostaje w puli do usunięcia struktury.
+            if (!child_put(&tree->children, (int)d, top)) {
+                bulk_forget_reverse(job, d);
+            }
+        }
     }
 }
 
 /**
- * @brief Funkcja sprawdza, czy elementy x w tablicy są postaci phfwdGet(x) = num.
- * Funkcja przystosowuje tablicę wygenerowaną przez phfwdReverse do warunku
- * phfwdGet(x) = num. Funkcja testuje to sprawdzając wywołanie funkcji phfwdGet
- * na każdym elemencie tablicy i jeśli element spełnia warunek phfwdGet(x) =
- * num, element x zostaje przeniesiony do tablicy wynikowej.
- * @param pf - wskaźnik na strukturę drzew;
- * @param answer - PhoneNumbers wygenerowane przez phfwdReverse;
- * @param num - dany przekierowany numer;
- * @return PhoneNumbers zawierające przeciwobraz funkcji phfwdGet.
+ * @brief Oddaje odwołania do numerów przekierowań, których nie dodano.
+ * @param[in, out] job - wskaźnik na pracę.
  */
-static PhoneNumbers * check_by_get (PhoneForward const *pf,
-                                    PhoneNumbers *answer, char const *num) {
-    size_t rubbish = 0;
-    bool nothing = 0;
-
-    for (size_t i = 0; i < answer->size; i++) {
-        PhoneNumbers *pnum = phfwdGet(pf, answer->table_of_phone_numbers[i]);
-        if (!check_if_same((char*)phnumGet(pnum, 0), (char*)num)) {
-            rubbish++;
+static void bulk_release(BulkJob *job) {
+    for (size_t i = 0; i < job->count; i++) {
+        BulkRule *rule = &job->rules[i];
+        if (rule->node == NODE_NULL) {
+            string_pool_release(job->pf->strings, rule->target);
+        }
+        if (rule->reverse == NODE_NULL) {
+            string_pool_release(job->pf->strings, rule->source);
         }
-        phnumDelete(pnum);
     }
+}
 
-    PhoneNumbers *new_answer = wider_allocation(answer->size - rubbish);
-    if (new_answer == NULL) {
-        return phnum_new_one();
+/**
+ * @brief Dodaje posortowane przekierowania do obu drzew.
+ * Poddrzewa pierwszych cyfr, których struktura jeszcze nie ma, wątki budują
+ * obok, a poddrzewa pozostałych cyfr zmienia w strukturze wątek wywołujący.
+ * @param[in, out] job - wskaźnik na pracę z posortowanymi częściami;
+ * @param[in] threads - liczba wątków.
+ */
+static void bulk_load(BulkJob *job, size_t threads) {
+    PhoneForward *pf = job->pf;
+    for (size_t d = 0; d < ALPHABET_SIZE; d++) {
+        BulkPart *part = &job->parts[d];
+        bulk_local_init(&part->local, pf->strings);
+        part->forward_aside =
+            (child_get(&fwd_node(pf, pf->new_tree)->children, (int)d) ==
+             NODE_NULL) &&
+            (bulk_first(job->forward_start, d) <
+             bulk_first(job->forward_start, d + 1));
+        part->reverse_aside =
+            (child_get(&rev_node(pf, pf->reversed_tree)->children, (int)d) ==
+             NODE_NULL) &&
+            (bulk_first(job->reverse_start, d) <
+             bulk_first(job->reverse_start, d + 1));
+    }
+    bulk_run(job, bulk_intern, ALPHABET_SIZE, threads);
+
+    bulk_run(job, bulk_forward_aside, ALPHABET_SIZE, threads);
+    for (size_t d = 0; d < ALPHABET_SIZE; d++) {
+        if (!job->parts[d].forward_aside) {
+            bulk_forward_part(job, pf, d);
+        }
     }
+    bulk_graft_forward(job, threads);
 
-    size_t j = 0;
-    for (size_t i = 0; i < answer->size; i++) {
-        PhoneNumbers *pnum = phfwdGet(pf, answer->table_of_phone_numbers[i]);
-        if (check_if_same((char*)phnumGet(pnum, 0), (char*)num)) {
-            size_t size = count_size(answer->table_of_phone_numbers[i], &nothing);
-            new_answer->table_of_phone_numbers[j] =
-            realloc(new_answer->table_of_phone_numbers[j],
-                    (size + 1) * sizeof(char));
-            string_copy(new_answer, answer->table_of_phone_numbers[i], j, size, 0);
-            if (new_answer->table_of_phone_numbers[j] == NULL) {
-                return NULL;
-            }
-            j++;
+    bulk_run(job, bulk_reverse_aside, ALPHABET_SIZE, threads);
+    for (size_t d = 0; d < ALPHABET_SIZE; d++) {
+        if (!job->parts[d].reverse_aside) {
+            bulk_reverse_part(job, pf, d);
         }
-        phnumDelete(pnum);
     }
+    bulk_graft_reverse(job, threads);
 
-    phnumDelete(answer);
-    return new_answer;
+    if (atomic_load_explicit(&job->failed, memory_order_relaxed)) {
+        bulk_release(job);
+    }
 }
 
-PhoneNumbers * phfwdGetReverse(PhoneForward const *pf, char const *num) {
-    if (pf == NULL) {
-        return NULL;
+bool phfwdLoadBulk(PhoneForward *pf, PhoneForwardRule const *rules,
+                   size_t count, size_t threads) {
+    if ((pf == NULL) || ((rules == NULL) && (count > 0))) {
+        return false;
     }
-    if ((num == NULL) || (num[0] == '\0') || error((char*)num)) {
-        return phnum_new_one();
+    if (count == 0) {
+        return true;
+    }
+    if (threads > BULK_MAX_THREADS) {
+        threads = BULK_MAX_THREADS;
     }
-    PhoneNumbers *answer = phfwdReverse(pf, num);
-    return check_by_get(pf, answer, num);
-}
\ No newline at end of file
+
+    BulkJob *job = malloc(sizeof(BulkJob));
+    if (job == NULL) {
+        return false;
+    }
+    job->pf = pf;
+    job->input = rules;
+    job->count = count;
+    job->rules = malloc(count * sizeof(BulkRule));
+    job->forward = malloc(count * sizeof(BulkRule*));
+    job->reverse = malloc(count * sizeof(BulkRule*));
+    atomic_init(&job->next_task, 0);
+    atomic_init(&job->invalid, false);
+    atomic_init(&job->failed, false);
+
+    bool added = false;
+    if ((job->rules != NULL) && (job->forward != NULL) &&
+        (job->reverse != NULL)) {
+        bulk_run(job, bulk_check, (count + BULK_CHUNK - 1) / BULK_CHUNK,
+                 threads);
+        if (!atomic_load_explicit(&job->invalid, memory_order_relaxed)) {
+            bulk_partition(job);
+            bulk_run(job, bulk_sort, 2 * BULK_BUCKETS, threads);
+
+            // Pamięć podręczną opróżniamy raz zamiast przy każdej parze.
+            if (pf->cache != NULL) {
+                number_cache_invalidate(pf->cache, "", 0);
+            }
+            bulk_load(job, threads);
+            // Pusty prefiks odświeża całą tablicę skoków.
+            jump_refresh(pf, "", 0);
+            added = !atomic_load_explicit(&job->failed, memory_order_relaxed);
+        }
+    }
+
+    free(job->rules);
+    free(job->forward);
+    free(job->reverse);
+    free(job);
+    return added;
+}
@@ -14,6 +14,13 @@
 
 /**
  * To jest struktura przechowująca przekierowania numerów telefonów.
+ * W wariancie PHFWD_CONCURRENT dowolnie wiele wątków może naraz wywoływać
+ * @ref phfwdGet, @ref phfwdGetN, @ref phfwdGetInto, @ref phfwdGetBatch,
+ * @ref phfwdReverse, @ref phfwdReverseN, @ref phfwdGetReverse
+ * i @ref phfwdFreeze, gdy jeden wątek wywołuje @ref phfwdAdd,
+ * @ref phfwdAddN, @ref phfwdLoadBulk i @ref phfwdRemove. Pozostałe
+ * funkcje, w tym iteratory wyników, wymagają wyłącznego dostępu do
+ * struktury.
  */
 struct PhoneForward;
 /**
@@ -30,6 +37,37 @@ struct PhoneNumbers;
  */
 typedef struct PhoneNumbers PhoneNumbers;
 
+/**
+ * To jest iterator po numerach przekierowywanych na dany numer.
+ */
+struct PhoneReverseIter;
+/**
+ * Tworzy typ PhoneReverseIter.
+ */
+typedef struct PhoneReverseIter PhoneReverseIter;
+
+/**
+ * To jest struktura przechowująca zamrożoną, tylko do odczytu, kopię
+ * przekierowań numerów telefonów.
+ */
+struct PhoneForwardFrozen;
+/**
+ * Tworzy typ PhoneForwardFrozen.
+ */
+typedef struct PhoneForwardFrozen PhoneForwardFrozen;
+
+/**
+ * To jest para numerów przekierowania dodawana przez @ref phfwdLoadBulk.
+ */
+struct PhoneForwardRule {
+    char const *num1; ///< Prefiks numerów przekierowywanych.
+    char const *num2; ///< Prefiks numerów, na które jest wykonywane przekierowanie.
+};
+/**
+ * Tworzy typ PhoneForwardRule.
+ */
+typedef struct PhoneForwardRule PhoneForwardRule;
+
 /** @brief Tworzy nową strukturę.
  * Tworzy nową strukturę niezawierającą żadnych przekierowań.
  * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
@@ -63,6 +101,47 @@ void phfwdDelete(PhoneForward *pf);
  */
 bool phfwdAdd(PhoneForward *pf, char const *num1, char const *num2);
 
+/** @brief Dodaje przekierowanie dla numerów o znanej długości.
+ * Działa tak jak @ref phfwdAdd, ale numerami są pierwsze @p length1 znaków
+ * @p num1 i pierwsze @p length2 znaków @p num2. Napisy nie muszą być
+ * zakończone znakiem '\0', a znak '\0' wewnątrz numeru jest niepoprawny.
+ * @param[in,out] pf    – wskaźnik na strukturę przechowującą przekierowania
+ *                        numerów;
+ * @param[in] num1      – wskaźnik na prefiks numerów przekierowywanych;
+ * @param[in] length1   – długość @p num1;
+ * @param[in] num2      – wskaźnik na prefiks numerów, na które jest
+ *                        wykonywane przekierowanie;
+ * @param[in] length2   – długość @p num2.
+ * @return Wartość @p true, jeśli przekierowanie zostało dodane.
+ *         Wartość @p false w tych samych przypadkach co @ref phfwdAdd.
+ */
+bool phfwdAddN(PhoneForward *pf, char const *num1, size_t length1,
+               char const *num2, size_t length2);
+
+/** @brief Dodaje wiele przekierowań naraz.
+ * Daje taki wynik jak wywołanie @ref phfwdAdd kolejno dla wszystkich par
+ * z @p rules: z kilku par o tym samym @p num1 obowiązuje ostatnia. Pary
+ * sprawdza, dzieli według dwóch pierwszych cyfr numerów i sortuje na
+ * @p threads wątkach. Poddrzewa pierwszych cyfr, których w @p pf jeszcze
+ * nie ma, wątki budują niezależnie obok i podpinają je na końcu, a pary
+ * o pierwszych cyfrach obecnych już w @p pf dodaje wątek wywołujący.
+ * Tablicę prefiksów każdego węzła drzewa odwróconego powiększa przy tym
+ * jeden raz. Jeśli @ref phfwdAdd odrzuciłaby którąś z par, nie dodaje
+ * żadnej.
+ * @param[in,out] pf  – wskaźnik na strukturę przechowującą przekierowania
+ *                      numerów;
+ * @param[in] rules   – tablica par numerów;
+ * @param[in] count   – liczba par;
+ * @param[in] threads – liczba wątków dzielących pracę, co najwyżej 64;
+ *                      wartości 0 i 1 oznaczają pracę w wątku wywołującym.
+ * @return Wartość @p true, jeśli wszystkie przekierowania zostały dodane.
+ *         Wartość @p false, jeśli @p pf jest równy NULL, któraś para nie
+ *         reprezentuje przekierowania lub nie udało się alokować pamięci;
+ *         w ostatnim przypadku część przekierowań mogła zostać dodana.
+ */
+bool phfwdLoadBulk(PhoneForward *pf, PhoneForwardRule const *rules,
+                   size_t count, size_t threads);
+
 /** @brief Usuwa przekierowania.
  * Usuwa wszystkie przekierowania, w których parametr @p num jest prefiksem
  * parametru @p num1 użytego przy dodawaniu. Jeśli nie ma takich przekierowań
@@ -87,6 +166,55 @@ void phfwdRemove(PhoneForward *pf, char const *num);
  */
 PhoneNumbers * phfwdGet(PhoneForward const *pf, char const *num);
 
+/** @brief Wyznacza przekierowanie numeru o znanej długości.
+ * Działa tak jak @ref phfwdGet dla numeru złożonego z pierwszych @p length
+ * znaków @p num. Napis nie musi być zakończony znakiem '\0'.
+ * @param[in] pf     – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów;
+ * @param[in] num    – wskaźnik na numer;
+ * @param[in] length – długość numeru.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+ *         udało się alokować pamięci lub pf jest równy NULL.
+ */
+PhoneNumbers * phfwdGetN(PhoneForward const *pf, char const *num,
+                         size_t length);
+
+/** @brief Wyznacza przekierowanie numeru do bufora.
+ * Działa tak jak @ref phfwdGet, ale nie alokuje pamięci: wynik zapisuje
+ * w buforze @p out jako napis zakończony znakiem '\0'. Wynik jest zapisywany
+ * tylko wtedy, gdy mieści się w całości, czyli gdy zwrócona długość jest
+ * mniejsza od @p capacity. W przeciwnym razie, jeśli @p capacity jest
+ * dodatnie, w buforze zostaje pusty napis. Wywołanie z @p out równym NULL
+ * służy do poznania potrzebnego rozmiaru bufora.
+ * @param[in] pf       – wskaźnik na strukturę przechowującą przekierowania
+ *                       numerów;
+ * @param[in] num      – wskaźnik na napis reprezentujący numer;
+ * @param[out] out     – bufor na wynik lub NULL;
+ * @param[in] capacity – rozmiar bufora @p out.
+ * @return Długość wyniku bez kończącego znaku '\0'. Wartość 0, jeśli
+ *         @p pf jest równy NULL lub podany napis nie reprezentuje numeru.
+ */
+size_t phfwdGetInto(PhoneForward const *pf, char const *num, char *out,
+                    size_t capacity);
+
+/** @brief Wyznacza przekierowania wielu numerów.
+ * Dla każdego k mniejszego od @p count działa tak jak
+ * phfwdGetInto(pf, nums[k], out[k], capacity) i zapisuje jego wynik
+ * w lengths[k], ale prowadzi kilka wyszukiwań naraz, żeby oczekiwanie na
+ * pamięć jednego z nich nakładało się na pracę pozostałych.
+ * @param[in] pf       – wskaźnik na strukturę przechowującą przekierowania
+ *                       numerów;
+ * @param[in] nums     – tablica @p count wskaźników na numery;
+ * @param[in] count    – liczba numerów;
+ * @param[out] out     – tablica @p count buforów na wyniki lub NULL; bufory
+ *                       mogą być równe NULL;
+ * @param[in] capacity – rozmiar każdego z buforów;
+ * @param[out] lengths – tablica na @p count długości wyników.
+ */
+void phfwdGetBatch(PhoneForward const *pf, char const * const *nums,
+                   size_t count, char * const *out, size_t capacity,
+                   size_t *lengths);
+
 /** @brief Wyznacza przekierowania na dany numer.
  * Wyznacza następujący ciąg numerów: jeśli istnieje numer @p x, taki że wynik
  * @p x jest prefiksem dla przekierowania @p num, to
@@ -102,6 +230,19 @@ PhoneNumbers * phfwdGet(PhoneForward const *pf, char const *num);
  */
 PhoneNumbers * phfwdReverse(PhoneForward const *pf, char const *num);
 
+/** @brief Wyznacza przekierowania na numer o znanej długości.
+ * Działa tak jak @ref phfwdReverse dla numeru złożonego z pierwszych
+ * @p length znaków @p num. Napis nie musi być zakończony znakiem '\0'.
+ * @param[in] pf     – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów;
+ * @param[in] num    – wskaźnik na numer;
+ * @param[in] length – długość numeru.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+ *         udało się alokować pamięci.
+ */
+PhoneNumbers * phfwdReverseN(PhoneForward const *pf, char const *num,
+                             size_t length);
+
 /** @brief Usuwa strukturę.
  * Usuwa strukturę wskazywaną przez @p pnum. Nic nie robi, jeśli wskaźnik ten ma
  * wartość NULL.
@@ -119,6 +260,24 @@ void phnumDelete(PhoneNumbers *pnum);
  */
 char const * phnumGet(PhoneNumbers const *pnum, size_t idx);
 
+/** @brief Scala posortowane ciągi numerów.
+ * Tworzy ciąg wszystkich numerów ciągów @p parts bez powtórzeń, w porządku
+ * wyników @ref phfwdReverse. Każdy z ciągów @p parts musi być w tym
+ * porządku posortowany, jak wyniki @ref phfwdReverse i @ref phfwdGetReverse.
+ * Jeśli @p keep jest różny od NULL, do wyniku trafiają tylko numery, dla
+ * których zwraca wartość @p true. Alokuje strukturę @p PhoneNumbers, która
+ * musi być zwolniona za pomocą funkcji @ref phnumDelete.
+ * @param[in] parts   – tablica @p count wskaźników na ciągi numerów;
+ * @param[in] count   – liczba ciągów;
+ * @param[in] keep    – funkcja wybierająca numery wyniku lub NULL;
+ * @param[in] context – pierwszy argument funkcji @p keep.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+ *         udało się alokować pamięci lub któryś z ciągów jest równy NULL.
+ */
+PhoneNumbers * phnumMerge(PhoneNumbers const * const *parts, size_t count,
+                          bool (*keep)(void *context, char const *num),
+                          void *context);
+
 /**
  * @brief Funkcja wyznacza przeciwobraz funkcji phfwdGet.
  * Funkcja wyznacza tablicę prefiksów danego numeru, tj. posortowaną
@@ -129,4 +288,101 @@ char const * phnumGet(PhoneNumbers const *pnum, size_t idx);
  */
 PhoneNumbers * phfwdGetReverse(PhoneForward const *pf, char const *num);
 
+/** @brief Tworzy iterator po wyniku @ref phfwdReverse.
+ * Iterator wydaje te same numery co @ref phfwdReverse, w tej samej
+ * kolejności, ale wyznacza je z drzewa dopiero przy kolejnych wywołaniach
+ * @ref phfwdReverseIterNext. Zajmuje pamięć zależną od długości numerów,
+ * a nie od liczby numerów w wyniku, więc można przerwać przeglądanie po
+ * kilku pierwszych numerach. Dodanie lub usunięcie przekierowań w @p pf
+ * unieważnia iterator; wolno go wtedy już tylko usunąć. Iterator należy
+ * zwolnić za pomocą funkcji @ref phfwdReverseIterDelete.
+ * @param[in] pf  – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na iterator lub NULL, gdy nie udało się alokować pamięci
+ *         lub @p pf jest równy NULL.
+ */
+PhoneReverseIter * phfwdReverseIter(PhoneForward const *pf, char const *num);
+
+/** @brief Tworzy iterator po wyniku @ref phfwdGetReverse.
+ * Działa tak jak @ref phfwdReverseIter, ale pomija numery @p x, dla których
+ * phfwdGet(x) jest różne od @p num.
+ * @param[in] pf  – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na iterator lub NULL, gdy nie udało się alokować pamięci
+ *         lub @p pf jest równy NULL.
+ */
+PhoneReverseIter * phfwdGetReverseIter(PhoneForward const *pf,
+                                       char const *num);
+
+/** @brief Udostępnia kolejny numer iteratora.
+ * @param[in,out] it – wskaźnik na iterator.
+ * @return Wskaźnik na napis reprezentujący numer, ważny do następnego
+ *         wywołania funkcji dla tego iteratora. Wartość NULL, jeśli numery się
+ *         skończyły, nie udało się alokować pamięci lub @p it jest równy
+ *         NULL.
+ */
+char const * phfwdReverseIterNext(PhoneReverseIter *it);
+
+/** @brief Usuwa iterator.
+ * Nic nie robi, jeśli wskaźnik @p it ma wartość NULL.
+ * @param[in] it – wskaźnik na usuwany iterator.
+ */
+void phfwdReverseIterDelete(PhoneReverseIter *it);
+
+/** @brief Ustawia rozmiar pamięci podręcznej wyników.
+ * Włącza w strukturze @p pf pamięć podręczną ostatnio sprawdzanych numerów,
+ * z której korzystają @ref phfwdGet, @ref phfwdGetN i @ref phfwdGetInto.
+ * Zapamiętywane są numery o długości co najwyżej 24 cyfr. Dodanie lub
+ * usunięcie przekierowań usuwa z pamięci tylko wyniki numerów o zmienianym
+ * prefiksie. Zmiana rozmiaru opróżnia pamięć i zeruje liczniki. W wariancie
+ * PHFWD_CONCURRENT pamięci podręcznej nie można włączyć.
+ * @param[in,out] pf     – wskaźnik na strukturę przechowującą przekierowania
+ *                         numerów;
+ * @param[in] capacity   – największa liczba zapamiętanych wyników;
+ *                         wartość 0 wyłącza pamięć podręczną.
+ * @return Wartość @p true, jeśli rozmiar został zmieniony.
+ *         Wartość @p false, jeśli @p pf jest równy NULL, rozmiar jest za duży
+ *         lub niezerowy w wariancie PHFWD_CONCURRENT lub nie udało się
+ *         alokować pamięci; dotychczasowa pamięć
+ *         podręczna zostaje wtedy bez zmian.
+ */
+bool phfwdCacheResize(PhoneForward *pf, size_t capacity);
+
+/** @brief Udostępnia liczniki pamięci podręcznej wyników.
+ * Gdy pamięć podręczna jest wyłączona, oba liczniki są równe 0.
+ * @param[in] pf      – wskaźnik na strukturę przechowującą przekierowania
+ *                      numerów;
+ * @param[out] hits   – liczba wyszukiwań, których wynik był zapamiętany,
+ *                      lub NULL;
+ * @param[out] misses – liczba pozostałych wyszukiwań lub NULL.
+ */
+void phfwdCacheStats(PhoneForward const *pf, size_t *hits, size_t *misses);
+
+/** @brief Zamraża przekierowania.
+ * Tworzy niezależną od @p pf kopię przekierowań tylko do odczytu, zapisaną
+ * w zwartych tablicach tak, aby wyszukiwanie nie chodziło po wskaźnikach.
+ * Późniejsze zmiany @p pf nie są w kopii widoczne. Kopię należy zwolnić za
+ * pomocą funkcji @ref phfwdFrozenDelete.
+ * @param[in] pf – wskaźnik na strukturę przechowującą przekierowania numerów.
+ * @return Wskaźnik na zamrożoną kopię lub NULL, gdy nie udało się alokować
+ *         pamięci lub @p pf jest równy NULL.
+ */
+PhoneForwardFrozen * phfwdFreeze(PhoneForward const *pf);
+
+/** @brief Wyznacza przekierowanie numeru w zamrożonej kopii.
+ * Działa tak jak @ref phfwdGet dla struktury, z której utworzono kopię.
+ * @param[in] pff – wskaźnik na zamrożoną kopię przekierowań;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+ *         udało się alokować pamięci lub @p pff jest równy NULL.
+ */
+PhoneNumbers * phfwdFrozenGet(PhoneForwardFrozen const *pff, char const *num);
+
+/** @brief Usuwa zamrożoną kopię.
+ * Usuwa strukturę wskazywaną przez @p pff. Nic nie robi, jeśli wskaźnik ten ma
+ * wartość NULL.
+ * @param[in] pff – wskaźnik na usuwaną kopię.
+ */
+void phfwdFrozenDelete(PhoneForwardFrozen *pff);
+
 #endif /* __PHONE_FORWARD_H__ */
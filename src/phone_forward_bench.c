@@ -0,0 +1,186 @@
+/** @file
+ * Pomiar szybkości wyszukiwania przekierowań
+ *
+ * Porównuje phfwdGet, schodzące po drzewie prefiksów, z phfwdGetInto, które
+ * robi to samo bez alokowania pamięci, z phfwdGetBatch, które prowadzi kilka
+ * takich wyszukiwań naraz, oraz z phfwdFrozenGet, które czyta
+ * zamrożoną kopię po dwie cyfry na krok. Zapytaniami są numery
+ * długości od 10 do 15 cyfr. Wywołanie:
+ *
+ *     phone_forward_bench [liczba_przekierowań [liczba_zapytań [ziarno]]]
+ *
+ * @author Maria Wysogląd
+ * @date 2022
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "phone_forward.h"
+
+#define DEFAULT_RULES 100000 ///< Domyślna liczba przekierowań.
+#define DEFAULT_QUERIES 1000000 ///< Domyślna liczba zapytań.
+#define MAX_NUMBER 16 ///< Rozmiar bufora na numer razem ze znakiem '\0'.
+#define BATCH 256 ///< Liczba zapytań przekazywanych naraz do phfwdGetBatch.
+
+/**
+ * @brief Losuje numer o długości z zadanego przedziału.
+ * Numery zaczynają się od krótkiej puli wspólnych początków, żeby przypominały
+ * prawdziwe tablice z numerami kierunkowymi.
+ * @param[out] num - bufor na co najmniej MAX_NUMBER znaków;
+ * @param[in] min_length - najmniejsza długość numeru;
+ * @param[in] max_length - największa długość numeru, mniejsza od MAX_NUMBER.
+ */
+static void random_number(char *num, int min_length, int max_length) {
+    int length = min_length + rand() % (max_length - min_length + 1);
+    num[0] = '1' + rand() % 3;
+    for (int i = 1; i < length; i++) {
+        num[i] = '0' + rand() % 10;
+    }
+    num[length] = '\0';
+}
+
+/**
+ * @brief Mierzy czas wyszukania wszystkich zapytań.
+ * @param[in] pf - struktura przekierowań lub NULL;
+ * @param[in] pff - zamrożona kopia, używana, gdy @p pf jest równe NULL;
+ * @param[in] queries - tablica zapytań;
+ * @param[in] count - liczba zapytań;
+ * @param[out] checksum - suma długości wyników.
+ * @return Czas w sekundach.
+ */
+static double measure(PhoneForward const *pf, PhoneForwardFrozen const *pff,
+                      char (*queries)[MAX_NUMBER], size_t count,
+                      size_t *checksum) {
+    *checksum = 0;
+    clock_t start = clock();
+    for (size_t i = 0; i < count; i++) {
+        PhoneNumbers *pnum = (pf != NULL) ? phfwdGet(pf, queries[i]) :
+                                            phfwdFrozenGet(pff, queries[i]);
+        *checksum += strlen(phnumGet(pnum, 0));
+        phnumDelete(pnum);
+    }
+
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+/**
+ * @brief Mierzy czas wyszukania wszystkich zapytań do bufora.
+ * @param[in] pf - struktura przekierowań;
+ * @param[in] queries - tablica zapytań;
+ * @param[in] count - liczba zapytań;
+ * @param[out] checksum - suma długości wyników.
+ * @return Czas w sekundach.
+ */
+static double measure_into(PhoneForward const *pf, char (*queries)[MAX_NUMBER],
+                           size_t count, size_t *checksum) {
+    char out[2 * MAX_NUMBER];
+    *checksum = 0;
+    clock_t start = clock();
+    for (size_t i = 0; i < count; i++) {
+        *checksum += phfwdGetInto(pf, queries[i], out, sizeof(out));
+    }
+
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+/**
+ * @brief Mierzy czas wyszukania wszystkich zapytań paczkami.
+ * @param[in] pf - struktura przekierowań;
+ * @param[in] queries - tablica zapytań;
+ * @param[in] count - liczba zapytań;
+ * @param[out] checksum - suma długości wyników.
+ * @return Czas w sekundach.
+ */
+static double measure_batch(PhoneForward const *pf, char (*queries)[MAX_NUMBER],
+                            size_t count, size_t *checksum) {
+    static char buffers[BATCH][2 * MAX_NUMBER];
+    char *out[BATCH];
+    char const *nums[BATCH];
+    size_t lengths[BATCH];
+    for (size_t k = 0; k < BATCH; k++) {
+        out[k] = buffers[k];
+    }
+
+    *checksum = 0;
+    clock_t start = clock();
+    for (size_t i = 0; i < count; i += BATCH) {
+        size_t size = (count - i < BATCH) ? count - i : BATCH;
+        for (size_t k = 0; k < size; k++) {
+            nums[k] = queries[i + k];
+        }
+        phfwdGetBatch(pf, nums, size, out, 2 * MAX_NUMBER, lengths);
+        for (size_t k = 0; k < size; k++) {
+            *checksum += lengths[k];
+        }
+    }
+
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+/**
+ * @brief Uruchamia pomiar.
+ * @param[in] argc - liczba argumentów;
+ * @param[in] argv - argumenty: liczba przekierowań, liczba zapytań, ziarno.
+ * @return Kod wyjścia: 0, gdy obie metody dały te same wyniki.
+ */
+int main(int argc, char *argv[]) {
+    size_t rules = (argc > 1) ? strtoul(argv[1], NULL, 10) : DEFAULT_RULES;
+    size_t count = (argc > 2) ? strtoul(argv[2], NULL, 10) : DEFAULT_QUERIES;
+    srand((argc > 3) ? (unsigned)strtoul(argv[3], NULL, 10) : 2022);
+
+    PhoneForward *pf = phfwdNew();
+    char (*queries)[MAX_NUMBER] = malloc(count * sizeof(*queries));
+    if ((pf == NULL) || (queries == NULL)) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    char num1[MAX_NUMBER];
+    char num2[MAX_NUMBER];
+    for (size_t i = 0; i < rules; i++) {
+        random_number(num1, 2, 12);
+        random_number(num2, 2, 12);
+        phfwdAdd(pf, num1, num2);
+    }
+    for (size_t i = 0; i < count; i++) {
+        random_number(queries[i], 10, 15);
+    }
+
+    clock_t start = clock();
+    PhoneForwardFrozen *pff = phfwdFreeze(pf);
+    double freeze_time = (double)(clock() - start) / CLOCKS_PER_SEC;
+    if (pff == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    size_t walk_sum = 0;
+    size_t into_sum = 0;
+    size_t batch_sum = 0;
+    size_t frozen_sum = 0;
+    double walk_time = measure(pf, NULL, queries, count, &walk_sum);
+    double into_time = measure_into(pf, queries, count, &into_sum);
+    double batch_time = measure_batch(pf, queries, count, &batch_sum);
+    double frozen_time = measure(NULL, pff, queries, count, &frozen_sum);
+
+    printf("rules: %zu, queries: %zu, freeze: %.3f s\n",
+           rules, count, freeze_time);
+    printf("phfwdGet:       %8.1f ns/query\n", 1e9 * walk_time / count);
+    printf("phfwdGetInto:   %8.1f ns/query\n", 1e9 * into_time / count);
+    printf("phfwdGetBatch:  %8.1f ns/query\n", 1e9 * batch_time / count);
+    printf("phfwdFrozenGet: %8.1f ns/query\n", 1e9 * frozen_time / count);
+
+    phfwdFrozenDelete(pff);
+    phfwdDelete(pf);
+    free(queries);
+
+    if ((walk_sum != into_sum) || (walk_sum != batch_sum) ||
+        (walk_sum != frozen_sum)) {
+        fprintf(stderr, "results differ\n");
+        return 1;
+    }
+
+    return 0;
+}
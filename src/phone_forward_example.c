@@ -3,10 +3,14 @@
 #endif
 
 #include "phone_forward.h"
+#include "phone_forward_live.h"
+#include "phone_forward_sharded.h"
 #include <assert.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdatomic.h>
+#include <threads.h>
 
 // String is 5MB
 #define BIG_STRING_SIZE 5242880
@@ -19,6 +23,167 @@ void printTestSuccess(int testNumber) {
   printf("Test %i: \033[0;32mPASSED\033[0m\n", testNumber);
 }
 
+#ifdef PHFWD_CONCURRENT
+#define READERS 4
+#define WRITER_ROUNDS 20000
+
+static atomic_bool writer_done;
+
+// Sprawdza, czy numer jest jednym z numerów zakończonej wartością NULL listy.
+static int isOneOf(char const *num, char const * const *allowed) {
+  for (size_t i = 0; allowed[i] != NULL; i++) {
+    if (strcmp(num, allowed[i]) == 0) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// Wątek czytający: każdy wynik musi odpowiadać któremuś stanowi struktury.
+static int readStructure(void *arg) {
+  PhoneForward const *pf = arg;
+  char const *get_results[] = {"1234", "534", "734", "564", NULL};
+  char const *reverse_534[] = {"1234", "534", NULL};
+  char const *reverse_564[] = {"1234", "1264", "564", NULL};
+  char buffer[32];
+  size_t rounds = 0;
+
+  while (!atomic_load(&writer_done) || rounds < 100) {
+    assert(phfwdGetInto(pf, "1234", buffer, sizeof(buffer)) > 0);
+    assert(isOneOf(buffer, get_results));
+
+    PhoneNumbers *pnum = phfwdReverse(pf, "534");
+    int found = 0;
+    for (size_t i = 0; phnumGet(pnum, i) != NULL; i++) {
+      assert(isOneOf(phnumGet(pnum, i), reverse_534));
+      found = found || (strcmp(phnumGet(pnum, i), "534") == 0);
+    }
+    assert(found);
+    phnumDelete(pnum);
+
+    pnum = phfwdGetReverse(pf, "564");
+    for (size_t i = 0; phnumGet(pnum, i) != NULL; i++) {
+      assert(isOneOf(phnumGet(pnum, i), reverse_564));
+    }
+    phnumDelete(pnum);
+    rounds++;
+  }
+  return 0;
+}
+#endif
+
+#define SHARD_WRITERS 4
+#define SHARD_RULES 1000
+
+// Wątek piszący: dodaje przekierowania numerów zaczynających się od jego cyfry.
+static int fillShard(void *arg) {
+  PhoneForwardSharded *pfs = arg;
+  static atomic_int next_writer;
+  // Miejsca starcza na najdłuższe liczby typu int.
+  char num1[24], num2[16];
+  int writer = atomic_fetch_add(&next_writer, 1);
+  for (int i = 0; i < SHARD_RULES; i++) {
+    sprintf(num1, "%d%04d", writer, i);
+    sprintf(num2, "9%d", writer);
+    if (!phfwdShardedAdd(pfs, num1, num2)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+#define LIVE_READERS 4
+#define LIVE_VERSIONS 200
+#define LIVE_RULES 1000
+
+static atomic_bool publisher_done;
+
+// Wypełnia wersję tablicy: numery 1xxxx kierują na prefiks z kontekstu.
+static bool fillLive(PhoneForward *pf, void *context) {
+  // Miejsca starcza na najdłuższą liczbę typu int.
+  char num1[16];
+  for (int i = 0; i < LIVE_RULES; i++) {
+    sprintf(num1, "1%04d", i);
+    if (!phfwdAdd(pf, num1, context)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Przerywa przebudowę po dodaniu części przekierowań.
+static bool failLive(PhoneForward *pf, void *context) {
+  (void)context;
+  assert(phfwdAdd(pf, "1", "2") == true);
+  return false;
+}
+
+// Wątek czytający: ostatnio dodane przekierowanie musi być w każdej wersji.
+static int readLive(void *arg) {
+  PhoneForwardLive const *live = arg;
+  size_t rounds = 0;
+
+  while (!atomic_load(&publisher_done) || rounds < 100) {
+    PhoneNumbers *pnum = phfwdLiveGet(live, "109995");
+    char const *num = phnumGet(pnum, 0);
+    assert((strcmp(num, "75") == 0) || (strcmp(num, "85") == 0));
+    phnumDelete(pnum);
+    rounds++;
+  }
+  return 0;
+}
+
+#define BULK_RULES 5000
+#define BULK_TARGETS 50
+
+static char bulk_num1[BULK_RULES][16];
+static char bulk_num2[BULK_RULES][8];
+
+// Zapisuje prefiks i-tego przekierowania testu wczytywania z dopiskiem.
+static void bulkNumber(char *out, unsigned i, char const *suffix) {
+  sprintf(out, (i % 5 == 0) ? "%u*%s" : "%u%s", i * 7919u % 100003u, suffix);
+}
+
+// Sprawdza, czy dwa ciągi numerów są równe.
+static int sameNumbers(PhoneNumbers const *a, PhoneNumbers const *b) {
+  size_t i = 0;
+  while ((phnumGet(a, i) != NULL) && (phnumGet(b, i) != NULL)) {
+    if (strcmp(phnumGet(a, i), phnumGet(b, i)) != 0) {
+      return 0;
+    }
+    i++;
+  }
+  return (phnumGet(a, i) == NULL) && (phnumGet(b, i) == NULL);
+}
+
+// Sprawdza, czy struktura daje te same wyniki co wzorcowa dla numerów testu.
+static int sameBulk(PhoneForward const *pf, PhoneForward const *expected) {
+  char query[24];
+  int same = 1;
+  for (unsigned i = 0; (i < BULK_RULES) && same; i++) {
+    bulkNumber(query, i, "0");
+    PhoneNumbers *want = phfwdGet(expected, query);
+    PhoneNumbers *pnum = phfwdGet(pf, query);
+    same = sameNumbers(pnum, want);
+    phnumDelete(pnum);
+    phnumDelete(want);
+  }
+  for (unsigned t = 0; (t < BULK_TARGETS) && same; t++) {
+    sprintf(query, "%u#1", t);
+    PhoneNumbers *want = phfwdReverse(expected, query);
+    PhoneNumbers *pnum = phfwdReverse(pf, query);
+    same = sameNumbers(pnum, want);
+    phnumDelete(pnum);
+    phnumDelete(want);
+    want = phfwdGetReverse(expected, query);
+    pnum = phfwdGetReverse(pf, query);
+    same = same && sameNumbers(pnum, want);
+    phnumDelete(pnum);
+    phnumDelete(want);
+  }
+  return same;
+}
+
 int main(void) {
   PhoneForward *pf;
   PhoneNumbers *pnum;
@@ -888,4 +1053,834 @@ int main(void) {
 	printTestSuccess(907);
 
   phfwdDelete(pf);
-}
\ No newline at end of file
+
+  printSection("Testing phfwdFreeze");
+  pf = phfwdNew();
+  assert(phfwdAdd(pf, "12", "9") == true);
+  assert(phfwdAdd(pf, "123456789012345678901", "7") == true);
+  assert(phfwdAdd(pf, "4", "*#") == true);
+
+  PhoneForwardFrozen *pff = phfwdFreeze(pf);
+  assert(pff != NULL);
+  pnum = phfwdFrozenGet(pff, "1234");
+  assert(strcmp(phnumGet(pnum, 0), "934") == 0);
+  phnumDelete(pnum);
+  printTestSuccess(1000);
+  pnum = phfwdFrozenGet(pff, "1234567890123456789012");
+  assert(strcmp(phnumGet(pnum, 0), "72") == 0);
+  phnumDelete(pnum);
+  printTestSuccess(1001);
+  pnum = phfwdFrozenGet(pff, "1");
+  assert(strcmp(phnumGet(pnum, 0), "1") == 0);
+  assert(phnumGet(pnum, 1) == NULL);
+  phnumDelete(pnum);
+  pnum = phfwdFrozenGet(pff, "45");
+  assert(strcmp(phnumGet(pnum, 0), "*#5") == 0);
+  phnumDelete(pnum);
+  printTestSuccess(1002);
+
+  // Zmiany po zamrożeniu nie są widoczne w kopii.
+  phfwdRemove(pf, "1");
+  pnum = phfwdFrozenGet(pff, "1234");
+  assert(strcmp(phnumGet(pnum, 0), "934") == 0);
+  phnumDelete(pnum);
+  phfwdDelete(pf);
+  pnum = phfwdFrozenGet(pff, "4");
+  assert(strcmp(phnumGet(pnum, 0), "*#") == 0);
+  phnumDelete(pnum);
+  printTestSuccess(1003);
+
+  assert(phfwdFrozenGet(NULL, "123") == NULL);
+  pnum = phfwdFrozenGet(pff, "12a");
+  assert(pnum != NULL);
+  assert(phnumGet(pnum, 0) == NULL);
+  phnumDelete(pnum);
+  pnum = phfwdFrozenGet(pff, NULL);
+  assert(phnumGet(pnum, 0) == NULL);
+  phnumDelete(pnum);
+  assert(phfwdFreeze(NULL) == NULL);
+  phfwdFrozenDelete(NULL);
+  phfwdFrozenDelete(pff);
+  printTestSuccess(1004);
+
+  // Przekierowania z prefiksów nieparzystej i parzystej długości.
+  pf = phfwdNew();
+  assert(phfwdAdd(pf, "1", "a") == false);
+  assert(phfwdAdd(pf, "123", "5") == true);
+  assert(phfwdAdd(pf, "1234", "6") == true);
+  assert(phfwdAdd(pf, "12345", "7") == true);
+  pff = phfwdFreeze(pf);
+  phfwdDelete(pf);
+  pnum = phfwdFrozenGet(pff, "12");
+  assert(strcmp(phnumGet(pnum, 0), "12") == 0);
+  phnumDelete(pnum);
+  pnum = phfwdFrozenGet(pff, "123");
+  assert(strcmp(phnumGet(pnum, 0), "5") == 0);
+  phnumDelete(pnum);
+  pnum = phfwdFrozenGet(pff, "1239");
+  assert(strcmp(phnumGet(pnum, 0), "59") == 0);
+  phnumDelete(pnum);
+  pnum = phfwdFrozenGet(pff, "12349");
+  assert(strcmp(phnumGet(pnum, 0), "69") == 0);
+  phnumDelete(pnum);
+  pnum = phfwdFrozenGet(pff, "123456");
+  assert(strcmp(phnumGet(pnum, 0), "76") == 0);
+  phnumDelete(pnum);
+  phfwdFrozenDelete(pff);
+  printTestSuccess(1005);
+
+  printSection("Testing shared target numbers");
+  pf = phfwdNew();
+  assert(phfwdAdd(pf, "1", "99") == true);
+  assert(phfwdAdd(pf, "2", "99") == true);
+  assert(phfwdAdd(pf, "3", "99") == true);
+  assert(phfwdAdd(pf, "99", "1") == true);
+  phfwdRemove(pf, "2");
+  assert(phfwdAdd(pf, "3", "7") == true);
+  pnum = phfwdReverse(pf, "995");
+  assert(strcmp(phnumGet(pnum, 0), "15") == 0);
+  assert(strcmp(phnumGet(pnum, 1), "995") == 0);
+  assert(phnumGet(pnum, 2) == NULL);
+  phnumDelete(pnum);
+  pnum = phfwdGet(pf, "14");
+  assert(strcmp(phnumGet(pnum, 0), "994") == 0);
+  phnumDelete(pnum);
+  printTestSuccess(1100);
+  phfwdRemove(pf, "1");
+  pnum = phfwdGet(pf, "995");
+  assert(strcmp(phnumGet(pnum, 0), "15") == 0);
+  phnumDelete(pnum);
+  pnum = phfwdReverse(pf, "1");
+  assert(strcmp(phnumGet(pnum, 0), "1") == 0);
+  assert(strcmp(phnumGet(pnum, 1), "99") == 0);
+  assert(phnumGet(pnum, 2) == NULL);
+  phnumDelete(pnum);
+  printTestSuccess(1101);
+  phfwdDelete(pf);
+
+  printSection("Testing phfwdGetInto");
+  pf = phfwdNew();
+  assert(phfwdAdd(pf, "12", "345") == true);
+  char buffer[8];
+  assert(phfwdGetInto(pf, "129", buffer, sizeof(buffer)) == 4);
+  assert(strcmp(buffer, "3459") == 0);
+  assert(phfwdGetInto(pf, "7*#", buffer, sizeof(buffer)) == 3);
+  assert(strcmp(buffer, "7*#") == 0);
+  printTestSuccess(1200);
+  assert(phfwdGetInto(pf, "120000", NULL, 0) == 7);
+  assert(phfwdGetInto(pf, "1200000", buffer, sizeof(buffer)) == 8);
+  assert(strcmp(buffer, "") == 0);
+  assert(phfwdGetInto(pf, "120000", buffer, 7) == 7);
+  assert(strcmp(buffer, "") == 0);
+  assert(phfwdGetInto(pf, "120000", buffer, 8) == 7);
+  assert(strcmp(buffer, "3450000") == 0);
+  printTestSuccess(1201);
+  assert(phfwdGetInto(NULL, "12", buffer, sizeof(buffer)) == 0);
+  assert(phfwdGetInto(pf, NULL, buffer, sizeof(buffer)) == 0);
+  assert(phfwdGetInto(pf, "", buffer, sizeof(buffer)) == 0);
+  assert(phfwdGetInto(pf, "1a", buffer, sizeof(buffer)) == 0);
+  assert(strcmp(buffer, "") == 0);
+  printTestSuccess(1202);
+  phfwdDelete(pf);
+
+  printSection("Testing phfwdGetBatch");
+  pf = phfwdNew();
+  assert(phfwdAdd(pf, "12", "345") == true);
+  assert(phfwdAdd(pf, "1234567890123456789", "0") == true);
+  assert(phfwdAdd(pf, "9", "#") == true);
+  {
+    char const *nums[] = {"129", "7", "12345678901234567891", "", "9*",
+                          NULL, "12x", "1", "98765"};
+    size_t const count = sizeof(nums) / sizeof(nums[0]);
+    char const *expected[] = {"3459", "7", "01", "", "#*", "", "", "1",
+                              "#8765"};
+    char buffers[9][32];
+    char *out[9];
+    size_t lengths[9];
+    for (size_t k = 0; k < count; k++) {
+      out[k] = buffers[k];
+    }
+    phfwdGetBatch(pf, nums, count, out, 32, lengths);
+    for (size_t k = 0; k < count; k++) {
+      assert(lengths[k] == strlen(expected[k]));
+      assert(strcmp(buffers[k], expected[k]) == 0);
+    }
+    printTestSuccess(1300);
+
+    phfwdGetBatch(pf, nums, count, NULL, 0, lengths);
+    for (size_t k = 0; k < count; k++) {
+      assert(lengths[k] == strlen(expected[k]));
+    }
+    phfwdGetBatch(NULL, nums, count, out, 32, lengths);
+    for (size_t k = 0; k < count; k++) {
+      assert(lengths[k] == 0);
+    }
+    printTestSuccess(1301);
+  }
+  phfwdDelete(pf);
+
+  printSection("Testing length-aware variants");
+  pf = phfwdNew();
+  assert(phfwdAddN(pf, "123456", 2, "3459", 3) == true);
+  assert(phfwdAddN(pf, "9\0", 2, "1", 1) == false);
+  assert(phfwdAddN(pf, "9", 0, "1", 1) == false);
+  assert(phfwdAddN(pf, "12", 2, "123", 2) == false);
+  pnum = phfwdGetN(pf, "1290000", 3);
+  assert(strcmp(phnumGet(pnum, 0), "3459") == 0);
+  assert(phnumGet(pnum, 1) == NULL);
+  phnumDelete(pnum);
+  printTestSuccess(1400);
+  pnum = phfwdGetN(pf, "12\09", 4);
+  assert(phnumGet(pnum, 0) == NULL);
+  phnumDelete(pnum);
+  pnum = phfwdGetN(pf, "12", 0);
+  assert(phnumGet(pnum, 0) == NULL);
+  phnumDelete(pnum);
+  pnum = phfwdGetN(pf, "12a", 2);
+  assert(strcmp(phnumGet(pnum, 0), "345") == 0);
+  phnumDelete(pnum);
+  printTestSuccess(1401);
+  pnum = phfwdReverseN(pf, "34590", 4);
+  assert(strcmp(phnumGet(pnum, 0), "129") == 0);
+  assert(strcmp(phnumGet(pnum, 1), "3459") == 0);
+  assert(phnumGet(pnum, 2) == NULL);
+  phnumDelete(pnum);
+  pnum = phfwdReverseN(pf, "34\0", 3);
+  assert(phnumGet(pnum, 0) == NULL);
+  phnumDelete(pnum);
+  printTestSuccess(1402);
+  phfwdDelete(pf);
+
+  printSection("Testing result cache");
+  pf = phfwdNew();
+#ifdef PHFWD_CONCURRENT
+  // Wariant współbieżny nie ma pamięci podręcznej.
+  assert(phfwdCacheResize(pf, 2) == false);
+  assert(phfwdCacheResize(pf, 0) == true);
+#else
+  size_t hits, misses;
+  phfwdCacheStats(pf, &hits, &misses);
+  assert(hits == 0 && misses == 0);
+  assert(phfwdCacheResize(pf, 2) == true);
+  assert(phfwdAdd(pf, "12", "3") == true);
+  assert(phfwdAdd(pf, "45", "6") == true);
+  pnum = phfwdGet(pf, "123");
+  phnumDelete(pnum);
+  pnum = phfwdGet(pf, "456");
+  phnumDelete(pnum);
+  pnum = phfwdGet(pf, "123");
+  assert(strcmp(phnumGet(pnum, 0), "33") == 0);
+  phnumDelete(pnum);
+  phfwdCacheStats(pf, &hits, &misses);
+  assert(hits == 1 && misses == 2);
+  printTestSuccess(1500);
+  assert(phfwdAdd(pf, "1", "7") == true);
+  assert(phfwdAdd(pf, "123", "8") == true);
+  pnum = phfwdGet(pf, "123");
+  assert(strcmp(phnumGet(pnum, 0), "8") == 0);
+  phnumDelete(pnum);
+  assert(phfwdGetInto(pf, "456", buffer, sizeof(buffer)) == 2);
+  assert(strcmp(buffer, "66") == 0);
+  phfwdCacheStats(pf, &hits, &misses);
+  assert(hits == 2 && misses == 3);
+  phfwdRemove(pf, "12");
+  pnum = phfwdGet(pf, "123");
+  assert(strcmp(phnumGet(pnum, 0), "723") == 0);
+  phnumDelete(pnum);
+  phfwdCacheStats(pf, &hits, &misses);
+  assert(hits == 2 && misses == 4);
+  printTestSuccess(1501);
+  pnum = phfwdGet(pf, "1234567890123456789012345");
+  phnumDelete(pnum);
+  pnum = phfwdGet(pf, "1234567890123456789012345");
+  assert(strcmp(phnumGet(pnum, 0), "7234567890123456789012345") == 0);
+  phnumDelete(pnum);
+  pnum = phfwdGet(pf, "4a");
+  assert(phnumGet(pnum, 0) == NULL);
+  phnumDelete(pnum);
+  phfwdCacheStats(pf, &hits, &misses);
+  assert(hits == 2 && misses == 7);
+  assert(phfwdCacheResize(pf, 0) == true);
+  phfwdCacheStats(pf, &hits, &misses);
+  assert(hits == 0 && misses == 0);
+  assert(phfwdCacheResize(NULL, 4) == false);
+  printTestSuccess(1502);
+#endif
+  phfwdDelete(pf);
+
+  printSection("Testing jump table");
+  pf = phfwdNew();
+  assert(phfwdAdd(pf, "1234", "5") == true);
+  assert(phfwdAdd(pf, "1567", "6") == true);
+  assert(phfwdAdd(pf, "15", "*") == true);
+  pnum = phfwdGet(pf, "15670");
+  assert(strcmp(phnumGet(pnum, 0), "60") == 0);
+  phnumDelete(pnum);
+  pnum = phfwdGet(pf, "1560");
+  assert(strcmp(phnumGet(pnum, 0), "*60") == 0);
+  phnumDelete(pnum);
+  printTestSuccess(1600);
+  phfwdRemove(pf, "15");
+  phfwdRemove(pf, "123");
+  pnum = phfwdGet(pf, "15670");
+  assert(strcmp(phnumGet(pnum, 0), "15670") == 0);
+  phnumDelete(pnum);
+  assert(phfwdAdd(pf, "1", "0") == true);
+  pnum = phfwdGet(pf, "1560");
+  assert(strcmp(phnumGet(pnum, 0), "0560") == 0);
+  phnumDelete(pnum);
+  pnum = phfwdGet(pf, "12");
+  assert(strcmp(phnumGet(pnum, 0), "02") == 0);
+  phnumDelete(pnum);
+  printTestSuccess(1601);
+  phfwdRemove(pf, "1");
+  pnum = phfwdGet(pf, "1234");
+  assert(strcmp(phnumGet(pnum, 0), "1234") == 0);
+  phnumDelete(pnum);
+  pnum = phfwdGet(pf, "12a4");
+  assert(phnumGet(pnum, 0) == NULL);
+  phnumDelete(pnum);
+  printTestSuccess(1602);
+  phfwdDelete(pf);
+
+  printSection("Testing numbers without applicable rules");
+  pf = phfwdNew();
+  assert(phfwdAdd(pf, "12345", "9") == true);
+  pnum = phfwdGet(pf, "1249");
+  assert(strcmp(phnumGet(pnum, 0), "1249") == 0);
+  phnumDelete(pnum);
+  pnum = phfwdGet(pf, "12399");
+  assert(strcmp(phnumGet(pnum, 0), "12399") == 0);
+  phnumDelete(pnum);
+  pnum = phfwdGet(pf, "123456");
+  assert(strcmp(phnumGet(pnum, 0), "96") == 0);
+  phnumDelete(pnum);
+  pnum = phfwdGet(pf, "777a");
+  assert(phnumGet(pnum, 0) == NULL);
+  phnumDelete(pnum);
+  printTestSuccess(1700);
+  {
+    char const *nums[] = {"777", "7770", "123456", "77#x", "1"};
+    char buffers[5][16];
+    char *out[5] = {buffers[0], buffers[1], buffers[2], buffers[3],
+                    buffers[4]};
+    size_t lengths[5];
+    phfwdGetBatch(pf, nums, 5, out, 16, lengths);
+    assert(lengths[0] == 3 && strcmp(buffers[0], "777") == 0);
+    assert(lengths[1] == 4 && strcmp(buffers[1], "7770") == 0);
+    assert(lengths[2] == 2 && strcmp(buffers[2], "96") == 0);
+    assert(lengths[3] == 0 && strcmp(buffers[3], "") == 0);
+    assert(lengths[4] == 1 && strcmp(buffers[4], "1") == 0);
+  }
+  printTestSuccess(1701);
+  assert(phfwdAdd(pf, "7", "0") == true);
+  pnum = phfwdGet(pf, "777");
+  assert(strcmp(phnumGet(pnum, 0), "077") == 0);
+  phnumDelete(pnum);
+  phfwdRemove(pf, "7");
+  phfwdRemove(pf, "1234");
+  pnum = phfwdGet(pf, "777");
+  assert(strcmp(phnumGet(pnum, 0), "777") == 0);
+  phnumDelete(pnum);
+  pnum = phfwdGet(pf, "123456");
+  assert(strcmp(phnumGet(pnum, 0), "123456") == 0);
+  phnumDelete(pnum);
+  printTestSuccess(1702);
+  phfwdDelete(pf);
+
+  printSection("Testing sorting of large reverse results");
+  pf = phfwdNew();
+  {
+    static char const symbols[] = "#*9876543210";
+    char num[8], longer[9];
+    for (int i = 0; i < 1728; i++) {
+      num[0] = '7';
+      num[1] = symbols[i % 12];
+      num[2] = symbols[(i / 12) % 12];
+      num[3] = symbols[i / 144];
+      num[4] = '\0';
+      strcpy(longer, num);
+      strcat(longer, "5");
+      assert(phfwdAdd(pf, num, "5") == true);
+      assert(phfwdAdd(pf, longer, "55") == true);
+    }
+    pnum = phfwdReverse(pf, "55");
+    size_t count = 0;
+    while (phnumGet(pnum, count) != NULL) {
+      count++;
+    }
+    assert(count == 1729);
+    assert(strcmp(phnumGet(pnum, 0), "55") == 0);
+    assert(strcmp(phnumGet(pnum, 1), "70005") == 0);
+    assert(strcmp(phnumGet(pnum, 2), "70015") == 0);
+    assert(strcmp(phnumGet(pnum, 12), "700#5") == 0);
+    assert(strcmp(phnumGet(pnum, 1728), "7###5") == 0);
+    phnumDelete(pnum);
+  }
+  printTestSuccess(1800);
+  phfwdDelete(pf);
+
+  pf = phfwdNew();
+  assert(phfwdAdd(pf, "1", "5") == true);
+  assert(phfwdAdd(pf, "12", "5") == true);
+  assert(phfwdAdd(pf, "123", "5") == true);
+  assert(phfwdAdd(pf, "2", "59") == true);
+  pnum = phfwdReverse(pf, "590");
+  assert(strcmp(phnumGet(pnum, 0), "12390") == 0);
+  assert(strcmp(phnumGet(pnum, 1), "1290") == 0);
+  assert(strcmp(phnumGet(pnum, 2), "190") == 0);
+  assert(strcmp(phnumGet(pnum, 3), "20") == 0);
+  assert(strcmp(phnumGet(pnum, 4), "590") == 0);
+  assert(phnumGet(pnum, 5) == NULL);
+  phnumDelete(pnum);
+  phfwdRemove(pf, "12");
+  pnum = phfwdReverse(pf, "590");
+  assert(strcmp(phnumGet(pnum, 0), "190") == 0);
+  assert(strcmp(phnumGet(pnum, 1), "20") == 0);
+  assert(strcmp(phnumGet(pnum, 2), "590") == 0);
+  assert(phnumGet(pnum, 3) == NULL);
+  phnumDelete(pnum);
+  printTestSuccess(1801);
+  phfwdDelete(pf);
+
+  printSection("Testing reverse maintenance in phfwdRemove");
+  pf = phfwdNew();
+  assert(phfwdAdd(pf, "12", "9") == true);
+  assert(phfwdAdd(pf, "123", "9") == true);
+  assert(phfwdAdd(pf, "13", "9") == true);
+  assert(phfwdAdd(pf, "124", "8") == true);
+  assert(phfwdAdd(pf, "2", "8") == true);
+  phfwdRemove(pf, "12");
+  pnum = phfwdReverse(pf, "9");
+  assert(strcmp(phnumGet(pnum, 0), "13") == 0);
+  assert(strcmp(phnumGet(pnum, 1), "9") == 0);
+  assert(phnumGet(pnum, 2) == NULL);
+  phnumDelete(pnum);
+  pnum = phfwdReverse(pf, "8");
+  assert(strcmp(phnumGet(pnum, 0), "2") == 0);
+  assert(strcmp(phnumGet(pnum, 1), "8") == 0);
+  assert(phnumGet(pnum, 2) == NULL);
+  phnumDelete(pnum);
+  printTestSuccess(1900);
+  assert(phfwdAdd(pf, "13", "8") == true);
+  assert(phfwdAdd(pf, "12", "9") == true);
+  phfwdRemove(pf, "1");
+  pnum = phfwdReverse(pf, "8");
+  assert(strcmp(phnumGet(pnum, 0), "2") == 0);
+  assert(strcmp(phnumGet(pnum, 1), "8") == 0);
+  assert(phnumGet(pnum, 2) == NULL);
+  phnumDelete(pnum);
+  pnum = phfwdReverse(pf, "9");
+  assert(strcmp(phnumGet(pnum, 0), "9") == 0);
+  assert(phnumGet(pnum, 1) == NULL);
+  phnumDelete(pnum);
+  printTestSuccess(1901);
+  phfwdDelete(pf);
+
+  // Przeciwobraz phfwdGet sprawdzany bez budowania wyników phfwdGet.
+  pf = phfwdNew();
+  assert(phfwdAdd(pf, "1", "5") == true);
+  assert(phfwdAdd(pf, "12", "56") == true);
+  assert(phfwdAdd(pf, "2", "51") == true);
+  pnum = phfwdGetReverse(pf, "563");
+  assert(strcmp(phnumGet(pnum, 0), "123") == 0);
+  assert(strcmp(phnumGet(pnum, 1), "163") == 0);
+  assert(strcmp(phnumGet(pnum, 2), "563") == 0);
+  assert(phnumGet(pnum, 3) == NULL);
+  phnumDelete(pnum);
+  printTestSuccess(2000);
+  pnum = phfwdGetReverse(pf, "5");
+  assert(strcmp(phnumGet(pnum, 0), "1") == 0);
+  assert(strcmp(phnumGet(pnum, 1), "5") == 0);
+  assert(phnumGet(pnum, 2) == NULL);
+  phnumDelete(pnum);
+  pnum = phfwdGetReverse(pf, "513");
+  assert(strcmp(phnumGet(pnum, 0), "113") == 0);
+  assert(strcmp(phnumGet(pnum, 1), "23") == 0);
+  assert(strcmp(phnumGet(pnum, 2), "513") == 0);
+  assert(phnumGet(pnum, 3) == NULL);
+  phnumDelete(pnum);
+  pnum = phfwdGetReverse(pf, "5a");
+  assert(phnumGet(pnum, 0) == NULL);
+  phnumDelete(pnum);
+  printTestSuccess(2001);
+  phfwdDelete(pf);
+
+  // Iterator wydaje numery phfwdReverse po kolei, bez budowania całego wyniku.
+  pf = phfwdNew();
+  assert(phfwdAdd(pf, "12", "5") == true);
+  assert(phfwdAdd(pf, "121", "5") == true);
+  assert(phfwdAdd(pf, "1", "56") == true);
+  PhoneReverseIter *iter = phfwdReverseIter(pf, "563");
+  pnum = phfwdReverse(pf, "563");
+  for (size_t i = 0;; i++) {
+    char const *next = phfwdReverseIterNext(iter);
+    if (next == NULL) {
+      assert(phnumGet(pnum, i) == NULL);
+      break;
+    }
+    assert(strcmp(next, phnumGet(pnum, i)) == 0);
+  }
+  assert(phfwdReverseIterNext(iter) == NULL);
+  phfwdReverseIterDelete(iter);
+  phnumDelete(pnum);
+  printTestSuccess(2100);
+  iter = phfwdGetReverseIter(pf, "563");
+  assert(strcmp(phfwdReverseIterNext(iter), "12163") == 0);
+  assert(strcmp(phfwdReverseIterNext(iter), "1263") == 0);
+  assert(strcmp(phfwdReverseIterNext(iter), "13") == 0);
+  assert(strcmp(phfwdReverseIterNext(iter), "563") == 0);
+  assert(phfwdReverseIterNext(iter) == NULL);
+  phfwdReverseIterDelete(iter);
+  iter = phfwdReverseIter(pf, "5*a");
+  assert(phfwdReverseIterNext(iter) == NULL);
+  phfwdReverseIterDelete(iter);
+  printTestSuccess(2101);
+  phfwdDelete(pf);
+
+  // Wynik jest jednym blokiem niezależnym od struktury.
+  pf = phfwdNew();
+  assert(phfwdAdd(pf, "9", "23") == true);
+  assert(phfwdAdd(pf, "98", "2") == true);
+  assert(phfwdAdd(pf, "7", "2") == true);
+  pnum = phfwdReverse(pf, "2345");
+  pnum2 = phfwdGet(pf, "98");
+  phfwdDelete(pf);
+  assert(strcmp(phnumGet(pnum, 0), "2345") == 0);
+  assert(strcmp(phnumGet(pnum, 1), "7345") == 0);
+  assert(strcmp(phnumGet(pnum, 2), "945") == 0);
+  assert(strcmp(phnumGet(pnum, 3), "98345") == 0);
+  assert(phnumGet(pnum, 4) == NULL);
+  assert(strcmp(phnumGet(pnum2, 0), "2") == 0);
+  assert(phnumGet(pnum2, 1) == NULL);
+  phnumDelete(pnum);
+  phnumDelete(pnum2);
+  printTestSuccess(2200);
+
+  // Numery wyniku phfwdReverse powstają przy odczycie z prefiksów puli.
+  pf = phfwdNew();
+  assert(phfwdAdd(pf, "31", "4") == true);
+  assert(phfwdAdd(pf, "5", "41") == true);
+  pnum = phfwdReverse(pf, "412");
+  assert(strcmp(phnumGet(pnum, 0), "3112") == 0);
+  phfwdRemove(pf, "3");
+  phfwdRemove(pf, "5");
+  assert(phfwdAdd(pf, "6", "4") == true);
+  assert(strcmp(phnumGet(pnum, 0), "3112") == 0);
+  assert(strcmp(phnumGet(pnum, 1), "412") == 0);
+  assert(strcmp(phnumGet(pnum, 2), "52") == 0);
+  assert(phnumGet(pnum, 3) == NULL);
+  phnumDelete(pnum);
+  pnum = phfwdGetReverse(pf, "412");
+  phfwdDelete(pf);
+  assert(strcmp(phnumGet(pnum, 0), "412") == 0);
+  assert(strcmp(phnumGet(pnum, 1), "612") == 0);
+  assert(phnumGet(pnum, 2) == NULL);
+  phnumDelete(pnum);
+  printTestSuccess(2300);
+
+  printSection("Testing sharded structure");
+  assert(phfwdShardedNew(0) == NULL);
+  assert(phfwdShardedNew(3) == NULL);
+  PhoneForwardSharded *pfs = phfwdShardedNew(2);
+  assert(phfwdShardedAdd(pfs, "1", "9") == true);
+  assert(phfwdShardedAdd(pfs, "12", "3") == true);
+  assert(phfwdShardedAdd(pfs, "34", "12") == true);
+  assert(phfwdShardedAdd(pfs, "5", "12") == true);
+  assert(phfwdShardedAdd(pfs, "5", "5") == false);
+  assert(phfwdShardedAdd(pfs, "a1", "5") == false);
+  pnum = phfwdShardedGet(pfs, "123");
+  assert(strcmp(phnumGet(pnum, 0), "33") == 0);
+  phnumDelete(pnum);
+  pnum = phfwdShardedGet(pfs, "13");
+  assert(strcmp(phnumGet(pnum, 0), "93") == 0);
+  phnumDelete(pnum);
+  pnum = phfwdShardedGet(pfs, "1");
+  assert(strcmp(phnumGet(pnum, 0), "9") == 0);
+  phnumDelete(pnum);
+  pnum = phfwdShardedGet(pfs, "7");
+  assert(strcmp(phnumGet(pnum, 0), "7") == 0);
+  phnumDelete(pnum);
+  pnum = phfwdShardedGet(pfs, "1a");
+  assert(phnumGet(pnum, 0) == NULL);
+  phnumDelete(pnum);
+  printTestSuccess(2500);
+  // Źródła przekierowań na jeden numer leżą w różnych częściach.
+  pnum = phfwdShardedReverse(pfs, "124");
+  assert(strcmp(phnumGet(pnum, 0), "124") == 0);
+  assert(strcmp(phnumGet(pnum, 1), "344") == 0);
+  assert(strcmp(phnumGet(pnum, 2), "54") == 0);
+  assert(phnumGet(pnum, 3) == NULL);
+  phnumDelete(pnum);
+  pnum = phfwdShardedGetReverse(pfs, "93");
+  assert(strcmp(phnumGet(pnum, 0), "13") == 0);
+  assert(strcmp(phnumGet(pnum, 1), "93") == 0);
+  assert(phnumGet(pnum, 2) == NULL);
+  phnumDelete(pnum);
+  // Przekierowanie z innej części przesłania przekierowanie pierwszej cyfry.
+  assert(phfwdShardedAdd(pfs, "13", "4") == true);
+  pnum = phfwdShardedGetReverse(pfs, "93");
+  assert(strcmp(phnumGet(pnum, 0), "93") == 0);
+  assert(phnumGet(pnum, 1) == NULL);
+  phnumDelete(pnum);
+  pnum = phfwdShardedReverse(pfs, "93");
+  assert(strcmp(phnumGet(pnum, 0), "13") == 0);
+  assert(strcmp(phnumGet(pnum, 1), "93") == 0);
+  assert(phnumGet(pnum, 2) == NULL);
+  phnumDelete(pnum);
+  printTestSuccess(2501);
+  phfwdShardedRemove(pfs, "1");
+  pnum = phfwdShardedGet(pfs, "123");
+  assert(strcmp(phnumGet(pnum, 0), "123") == 0);
+  phnumDelete(pnum);
+  pnum = phfwdShardedGet(pfs, "13");
+  assert(strcmp(phnumGet(pnum, 0), "13") == 0);
+  phnumDelete(pnum);
+  pnum = phfwdShardedGet(pfs, "345");
+  assert(strcmp(phnumGet(pnum, 0), "125") == 0);
+  phnumDelete(pnum);
+  pnum = phfwdShardedGetReverse(pfs, "125");
+  assert(strcmp(phnumGet(pnum, 0), "125") == 0);
+  assert(strcmp(phnumGet(pnum, 1), "345") == 0);
+  assert(strcmp(phnumGet(pnum, 2), "55") == 0);
+  assert(phnumGet(pnum, 3) == NULL);
+  phnumDelete(pnum);
+  phfwdShardedDelete(pfs);
+  printTestSuccess(2502);
+  // Wątki dodają przekierowania w różnych częściach naraz.
+  pfs = phfwdShardedNew(1);
+  thrd_t writers[SHARD_WRITERS];
+  for (size_t i = 0; i < SHARD_WRITERS; i++) {
+    assert(thrd_create(&writers[i], fillShard, pfs) == thrd_success);
+  }
+  for (size_t i = 0; i < SHARD_WRITERS; i++) {
+    int result;
+    assert(thrd_join(writers[i], &result) == thrd_success);
+    assert(result == 0);
+  }
+  pnum = phfwdShardedGet(pfs, "20123#");
+  assert(strcmp(phnumGet(pnum, 0), "92#") == 0);
+  phnumDelete(pnum);
+  pnum = phfwdShardedGetReverse(pfs, "935");
+  for (size_t i = 0; i < SHARD_RULES; i++) {
+    sprintf(buffer, "3%04zu5", i);
+    assert(strcmp(phnumGet(pnum, i), buffer) == 0);
+  }
+  assert(strcmp(phnumGet(pnum, SHARD_RULES), "935") == 0);
+  assert(phnumGet(pnum, SHARD_RULES + 1) == NULL);
+  phnumDelete(pnum);
+  pnum = phfwdShardedReverse(pfs, "91");
+  for (size_t i = 0; i < SHARD_RULES; i++) {
+    sprintf(buffer, "1%04zu", i);
+    assert(strcmp(phnumGet(pnum, i), buffer) == 0);
+  }
+  assert(strcmp(phnumGet(pnum, SHARD_RULES), "91") == 0);
+  phnumDelete(pnum);
+  phfwdShardedDelete(pfs);
+  printTestSuccess(2503);
+
+  printSection("Testing published table");
+  PhoneForwardLive *live = phfwdLiveNew();
+  pnum = phfwdLiveGet(live, "123");
+  assert(strcmp(phnumGet(pnum, 0), "123") == 0);
+  phnumDelete(pnum);
+  pnum = phfwdLiveGet(live, "1a");
+  assert(phnumGet(pnum, 0) == NULL);
+  phnumDelete(pnum);
+  assert(phfwdLiveGet(NULL, "1") == NULL);
+  assert(phfwdLivePublish(live, NULL) == false);
+  pf = phfwdNew();
+  assert(phfwdAdd(pf, "12", "5") == true);
+  assert(phfwdAdd(pf, "3", "45") == true);
+  assert(phfwdLivePublish(live, pf) == true);
+  // Zmiany po publikacji nie trafiają do tablicy.
+  assert(phfwdAdd(pf, "1", "9") == true);
+  phfwdDelete(pf);
+  pnum = phfwdLiveGet(live, "123");
+  assert(strcmp(phnumGet(pnum, 0), "53") == 0);
+  phnumDelete(pnum);
+  pnum = phfwdLiveGet(live, "14");
+  assert(strcmp(phnumGet(pnum, 0), "14") == 0);
+  phnumDelete(pnum);
+  pnum = phfwdLiveGet(live, "31");
+  assert(strcmp(phnumGet(pnum, 0), "451") == 0);
+  phnumDelete(pnum);
+  printTestSuccess(2600);
+  assert(phfwdLiveWait(live) == false);
+  assert(phfwdLiveRebuild(live, fillLive, "7") == true);
+  assert(phfwdLiveRebuild(live, fillLive, "8") == false);
+  assert(phfwdLiveWait(live) == true);
+  pnum = phfwdLiveGet(live, "100425");
+  assert(strcmp(phnumGet(pnum, 0), "75") == 0);
+  phnumDelete(pnum);
+  pnum = phfwdLiveGet(live, "123");
+  assert(strcmp(phnumGet(pnum, 0), "123") == 0);
+  phnumDelete(pnum);
+  // Nieudana przebudowa zostawia poprzednią wersję.
+  assert(phfwdLiveRebuild(live, failLive, NULL) == true);
+  assert(phfwdLiveWait(live) == false);
+  pnum = phfwdLiveGet(live, "100425");
+  assert(strcmp(phnumGet(pnum, 0), "75") == 0);
+  phnumDelete(pnum);
+  printTestSuccess(2601);
+  // Wątki czytają tablicę, której wersje podmienia wątek przebudowy.
+  thrd_t live_readers[LIVE_READERS];
+  atomic_init(&publisher_done, false);
+  for (size_t i = 0; i < LIVE_READERS; i++) {
+    assert(thrd_create(&live_readers[i], readLive, live) == thrd_success);
+  }
+  for (size_t version = 0; version < LIVE_VERSIONS; version++) {
+    assert(phfwdLiveRebuild(live, fillLive, (version % 2) ? "7" : "8"));
+    assert(phfwdLiveWait(live) == true);
+  }
+  atomic_store(&publisher_done, true);
+  for (size_t i = 0; i < LIVE_READERS; i++) {
+    assert(thrd_join(live_readers[i], NULL) == thrd_success);
+  }
+  // Usunięcie czeka na trwającą przebudowę.
+  assert(phfwdLiveRebuild(live, fillLive, "7") == true);
+  phfwdLiveDelete(live);
+  phfwdLiveDelete(NULL);
+  printTestSuccess(2602);
+
+  printSection("Testing bulk loading");
+  PhoneForwardRule pairs[] = {{"12", "3"}, {"5", "12"}, {"12", "4"},
+                              {"123", "9"}, {"1", "9"}};
+  assert(phfwdLoadBulk(NULL, pairs, 5, 2) == false);
+  pf = phfwdNew();
+  assert(phfwdLoadBulk(pf, NULL, 0, 2) == true);
+  assert(phfwdLoadBulk(pf, pairs, 5, 2) == true);
+  pnum = phfwdGet(pf, "125");
+  assert(strcmp(phnumGet(pnum, 0), "45") == 0);
+  phnumDelete(pnum);
+  pnum = phfwdGet(pf, "1234");
+  assert(strcmp(phnumGet(pnum, 0), "94") == 0);
+  phnumDelete(pnum);
+  pnum = phfwdGet(pf, "17");
+  assert(strcmp(phnumGet(pnum, 0), "97") == 0);
+  phnumDelete(pnum);
+  pnum = phfwdReverse(pf, "94");
+  assert(strcmp(phnumGet(pnum, 0), "1234") == 0);
+  assert(strcmp(phnumGet(pnum, 1), "14") == 0);
+  assert(strcmp(phnumGet(pnum, 2), "94") == 0);
+  assert(phnumGet(pnum, 3) == NULL);
+  phnumDelete(pnum);
+  // Zastąpione przekierowanie znika z drzewa odwróconego.
+  pnum = phfwdReverse(pf, "3");
+  assert(strcmp(phnumGet(pnum, 0), "3") == 0);
+  assert(phnumGet(pnum, 1) == NULL);
+  phnumDelete(pnum);
+  printTestSuccess(2700);
+  // Jedna błędna para sprawia, że nie dodajemy żadnej.
+  PhoneForwardRule wrong[] = {{"7", "8"}, {"6", "6"}};
+  assert(phfwdLoadBulk(pf, wrong, 2, 2) == false);
+  wrong[1].num2 = "6a";
+  assert(phfwdLoadBulk(pf, wrong, 2, 1) == false);
+  wrong[1].num2 = NULL;
+  assert(phfwdLoadBulk(pf, wrong, 2, 1) == false);
+  pnum = phfwdGet(pf, "7");
+  assert(strcmp(phnumGet(pnum, 0), "7") == 0);
+  phnumDelete(pnum);
+  // Nowe przekierowania zastępują dodane wcześniej.
+  PhoneForwardRule again[] = {{"12", "7"}, {"5", "8"}};
+  assert(phfwdLoadBulk(pf, again, 2, 0) == true);
+  pnum = phfwdGet(pf, "125");
+  assert(strcmp(phnumGet(pnum, 0), "75") == 0);
+  phnumDelete(pnum);
+  pnum = phfwdReverse(pf, "45");
+  assert(strcmp(phnumGet(pnum, 0), "45") == 0);
+  assert(phnumGet(pnum, 1) == NULL);
+  phnumDelete(pnum);
+  pnum = phfwdGetReverse(pf, "81");
+  assert(strcmp(phnumGet(pnum, 0), "51") == 0);
+  assert(strcmp(phnumGet(pnum, 1), "81") == 0);
+  assert(phnumGet(pnum, 2) == NULL);
+  phnumDelete(pnum);
+  phfwdDelete(pf);
+  printTestSuccess(2701);
+  // Wynik jest taki sam jak po kolejnych wywołaniach phfwdAdd.
+  PhoneForwardRule *bulk = malloc(BULK_RULES * sizeof(PhoneForwardRule));
+  assert(bulk != NULL);
+  for (unsigned i = 0; i < BULK_RULES; i++) {
+    bulkNumber(bulk_num1[i], i, "");
+    sprintf(bulk_num2[i], "%u#", i % BULK_TARGETS);
+    bulk[i] = (PhoneForwardRule){bulk_num1[i], bulk_num2[i]};
+  }
+  PhoneForward *expected = phfwdNew();
+  for (size_t i = 0; i < BULK_RULES; i++) {
+    assert(phfwdAdd(expected, bulk_num1[i], bulk_num2[i]) == true);
+  }
+  pf = phfwdNew();
+  // W wariancie PHFWD_CONCURRENT pamięć podręczna zostaje wyłączona.
+  phfwdCacheResize(pf, 64);
+  char query[24];
+  for (unsigned i = 0; i < 64; i++) {
+    bulkNumber(query, i, "0");
+    phnumDelete(phfwdGet(pf, query));
+  }
+  assert(phfwdLoadBulk(pf, bulk, BULK_RULES, 4) == true);
+  assert(sameBulk(pf, expected));
+  phfwdDelete(pf);
+  phfwdDelete(expected);
+  printTestSuccess(2702);
+  /* Poddrzewa cyfr, których struktura nie ma, powstają obok, a pozostałe
+  zmienia wątek wywołujący. Obie części muszą dalej działać jak zwykle. */
+  PhoneForwardRule present[] = {{"1#", "4#7"}, {"3#2", "2#"}, {"##", "9"}};
+  expected = phfwdNew();
+  pf = phfwdNew();
+  for (size_t i = 0; i < 3; i++) {
+    assert(phfwdAdd(expected, present[i].num1, present[i].num2) == true);
+    assert(phfwdAdd(pf, present[i].num1, present[i].num2) == true);
+  }
+  for (size_t i = 0; i < BULK_RULES; i++) {
+    assert(phfwdAdd(expected, bulk_num1[i], bulk_num2[i]) == true);
+  }
+  assert(phfwdLoadBulk(pf, bulk, BULK_RULES, 3) == true);
+  assert(sameBulk(pf, expected));
+  pnum = phfwdReverse(pf, "91");
+  assert(strcmp(phnumGet(pnum, 0), "91") == 0);
+  assert(strcmp(phnumGet(pnum, 1), "##1") == 0);
+  assert(phnumGet(pnum, 2) == NULL);
+  phnumDelete(pnum);
+  phfwdRemove(expected, "12");
+  phfwdRemove(pf, "12");
+  phfwdRemove(expected, "5");
+  phfwdRemove(pf, "5");
+  for (unsigned i = 0; i < 200; i++) {
+    bulkNumber(query, i, "3");
+    assert(phfwdAdd(expected, query, "6#") == true);
+    assert(phfwdAdd(pf, query, "6#") == true);
+  }
+  assert(sameBulk(pf, expected));
+  phfwdDelete(pf);
+  phfwdDelete(expected);
+  free(bulk);
+  printTestSuccess(2703);
+
+#ifdef PHFWD_CONCURRENT
+  printSection("Testing concurrent readers");
+  // Wątki czytają strukturę, którą w tym czasie zmienia wątek główny.
+  pf = phfwdNew();
+  thrd_t readers[READERS];
+  atomic_init(&writer_done, false);
+  for (size_t i = 0; i < READERS; i++) {
+    assert(thrd_create(&readers[i], readStructure, pf) == thrd_success);
+  }
+  for (size_t round = 0; round < WRITER_ROUNDS; round++) {
+    assert(phfwdAdd(pf, "12", "5") == true);
+    assert(phfwdAdd(pf, "12", "7") == true);
+    assert(phfwdAdd(pf, "123", "56") == true);
+    assert(phfwdAdd(pf, "1200000000000000000001", "0") == true);
+    assert(phfwdAdd(pf, "1230000000000000000000", "9") == true);
+    phfwdRemove(pf, "120");
+    phfwdRemove(pf, "123");
+    phfwdRemove(pf, "12");
+  }
+  atomic_store(&writer_done, true);
+  for (size_t i = 0; i < READERS; i++) {
+    assert(thrd_join(readers[i], NULL) == thrd_success);
+  }
+  phfwdDelete(pf);
+  printTestSuccess(2400);
+#endif
+}
@@ -0,0 +1,144 @@
+/** @file
+ * Implementacja interfejsu phone_forward_live.h.
+ *
+ * @author Maria Wysogląd
+ * @date 2022
+ */
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <threads.h>
+
+#include "epoch.h"
+#include "phone_forward_live.h"
+
+/**
+ * @brief To jest tablica przekierowań podmieniana w całości.
+ * Odczyt ogłasza się w domenie @p epoch, zanim odczyta @p current, więc
+ * publikacja po podmianie wskaźnika wie, na które odczyty poczekać.
+ */
+struct PhoneForwardLive {
+    _Atomic(PhoneForwardFrozen *) current; ///< Opublikowana wersja.
+    EpochDomain *epoch; ///< Domena ogłoszeń odczytów.
+    mtx_t publish_lock; ///< Blokada szeregująca publikacje.
+    thrd_t builder; ///< Wątek przebudowy.
+    bool building; ///< Czy wątek przebudowy nie został jeszcze dołączony.
+    bool (*fill)(PhoneForward *, void *); ///< Funkcja wypełniająca przebudowy.
+    void *context; ///< Drugi argument funkcji @p fill.
+};
+
+PhoneForwardLive * phfwdLiveNew(void) {
+    PhoneForwardLive *live = malloc(sizeof(PhoneForwardLive));
+    if (live == NULL) {
+        return NULL;
+    }
+
+    PhoneForward *empty = phfwdNew();
+    PhoneForwardFrozen *frozen = phfwdFreeze(empty);
+    phfwdDelete(empty);
+    live->epoch = epoch_new();
+    if ((frozen == NULL) || (live->epoch == NULL) ||
+        (mtx_init(&live->publish_lock, mtx_plain) != thrd_success)) {
+        phfwdFrozenDelete(frozen);
+        epoch_delete(live->epoch);
+        free(live);
+        return NULL;
+    }
+    atomic_init(&live->current, frozen);
+    live->building = false;
+    live->fill = NULL;
+    live->context = NULL;
+
+    return live;
+}
+
+void phfwdLiveDelete(PhoneForwardLive *live) {
+    if (live != NULL) {
+        phfwdLiveWait(live);
+        phfwdFrozenDelete(atomic_load_explicit(&live->current,
+                                               memory_order_relaxed));
+        epoch_delete(live->epoch);
+        mtx_destroy(&live->publish_lock);
+        free(live);
+    }
+}
+
+bool phfwdLivePublish(PhoneForwardLive *live, PhoneForward const *pf) {
+    if ((live == NULL) || (pf == NULL)) {
+        return false;
+    }
+
+    // Zamrażanie trwa najdłużej, więc robimy je przed blokadą.
+    PhoneForwardFrozen *frozen = phfwdFreeze(pf);
+    if (frozen == NULL) {
+        return false;
+    }
+
+    mtx_lock(&live->publish_lock);
+    PhoneForwardFrozen *old = atomic_exchange_explicit(&live->current, frozen,
+                                                       memory_order_acq_rel);
+    /* Nowe odczyty widzą już nową wersję, a starą mogą trzymać tylko te,
+    które trwały w chwili podmiany. */
+    epoch_synchronize(live->epoch);
+    mtx_unlock(&live->publish_lock);
+    phfwdFrozenDelete(old);
+
+    return true;
+}
+
+/**
+ * @brief Wypełnia i publikuje nową wersję tablicy.
+ * Jest funkcją wątku przebudowy.
+ * @param[in, out] arg - wskaźnik na tablicę PhoneForwardLive.
+ * @return 1, jeśli nowa wersja została opublikowana, lub 0 w przeciwnym
+ *         przypadku.
+ */
+static int rebuild(void *arg) {
+    PhoneForwardLive *live = arg;
+    PhoneForward *pf = phfwdNew();
+    bool published = (pf != NULL) && live->fill(pf, live->context) &&
+                     phfwdLivePublish(live, pf);
+    phfwdDelete(pf);
+
+    return published ? 1 : 0;
+}
+
+bool phfwdLiveRebuild(PhoneForwardLive *live,
+                      bool (*fill)(PhoneForward *pf, void *context),
+                      void *context) {
+    if ((live == NULL) || (fill == NULL) || live->building) {
+        return false;
+    }
+
+    live->fill = fill;
+    live->context = context;
+    live->building = (thrd_create(&live->builder, rebuild, live) ==
+                      thrd_success);
+
+    return live->building;
+}
+
+bool phfwdLiveWait(PhoneForwardLive *live) {
+    if ((live == NULL) || !live->building) {
+        return false;
+    }
+
+    int published = 0;
+    thrd_join(live->builder, &published);
+    live->building = false;
+
+    return published == 1;
+}
+
+PhoneNumbers * phfwdLiveGet(PhoneForwardLive const *live, char const *num) {
+    if (live == NULL) {
+        return NULL;
+    }
+
+    size_t slot = epoch_enter(live->epoch);
+    PhoneForwardFrozen const *frozen =
+        atomic_load_explicit(&live->current, memory_order_acquire);
+    PhoneNumbers *answer = phfwdFrozenGet(frozen, num);
+    epoch_exit(live->epoch, slot);
+
+    return answer;
+}
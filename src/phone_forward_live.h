@@ -0,0 +1,91 @@
+/** @file
+ * Interfejs tablicy przekierowań podmienianej w całości podczas odczytów
+ *
+ * @author Maria Wysogląd
+ * @date 2022
+ */
+
+#ifndef __PHONE_FORWARD_LIVE_H__
+#define __PHONE_FORWARD_LIVE_H__
+
+#include <stdbool.h>
+
+#include "phone_forward.h"
+
+/**
+ * To jest tablica przekierowań, z której wiele wątków naraz wyznacza
+ * przekierowania numerów. Trzyma zamrożoną kopię @ref PhoneForwardFrozen,
+ * której nikt nie zmienia. Nową wersję budujemy obok i podmieniamy jedną
+ * atomową zamianą wskaźnika, więc odczyt widzi zawsze całą starą albo całą
+ * nową wersję. Starą wersję zwalniamy, gdy skończą się odczyty, które mogły
+ * ją widzieć.
+ */
+struct PhoneForwardLive;
+/**
+ * Tworzy typ PhoneForwardLive.
+ */
+typedef struct PhoneForwardLive PhoneForwardLive;
+
+/** @brief Tworzy nową tablicę.
+ * Tablica nie zawiera żadnych przekierowań.
+ * @return Wskaźnik na utworzoną tablicę lub NULL, gdy nie udało się alokować
+ *         pamięci.
+ */
+PhoneForwardLive * phfwdLiveNew(void);
+
+/** @brief Usuwa tablicę.
+ * Czeka najpierw na koniec przebudowy rozpoczętej przez
+ * @ref phfwdLiveRebuild. Nic nie robi, jeśli @p live ma wartość NULL. Żaden
+ * inny wątek nie może wtedy korzystać z tablicy.
+ * @param[in] live – wskaźnik na usuwaną tablicę.
+ */
+void phfwdLiveDelete(PhoneForwardLive *live);
+
+/** @brief Publikuje nową wersję przekierowań.
+ * Zamraża @p pf, podmienia wersję tablicy i czeka, aż skończą się odczyty
+ * starej wersji, po czym ją zwalnia. Odczyty w tym czasie nie czekają.
+ * Późniejsze zmiany @p pf nie są w tablicy widoczne. Można ją wywoływać
+ * naraz z wielu wątków, wygrywa wtedy ostatnia podmiana.
+ * @param[in,out] live – wskaźnik na tablicę;
+ * @param[in] pf       – wskaźnik na strukturę z nowymi przekierowaniami.
+ * @return Wartość @p true, jeśli wersja została podmieniona.
+ *         Wartość @p false, jeśli nie udało się alokować pamięci lub któryś
+ *         z parametrów jest równy NULL. Tablica ma wtedy poprzednią wersję.
+ */
+bool phfwdLivePublish(PhoneForwardLive *live, PhoneForward const *pf);
+
+/** @brief Przebudowuje tablicę w osobnym wątku.
+ * Tworzy wątek, który wypełnia nową strukturę funkcją @p fill, a jeśli
+ * zwróci ona @p true, publikuje ją funkcją @ref phfwdLivePublish. Wynik
+ * przebudowy zwraca @ref phfwdLiveWait. Tę funkcję, @ref phfwdLiveWait
+ * i @ref phfwdLiveDelete wywołuje tylko jeden wątek.
+ * @param[in,out] live – wskaźnik na tablicę;
+ * @param[in] fill     – funkcja dodająca przekierowania do pustej struktury;
+ * @param[in] context  – drugi argument funkcji @p fill.
+ * @return Wartość @p true, jeśli przebudowa się zaczęła.
+ *         Wartość @p false, jeśli trwa poprzednia przebudowa, nie udało się
+ *         utworzyć wątku lub któryś ze wskaźników jest równy NULL.
+ */
+bool phfwdLiveRebuild(PhoneForwardLive *live,
+                      bool (*fill)(PhoneForward *pf, void *context),
+                      void *context);
+
+/** @brief Czeka na koniec przebudowy.
+ * @param[in,out] live – wskaźnik na tablicę.
+ * @return Wartość @p true, jeśli ostatnia przebudowa opublikowała nową
+ *         wersję. Wartość @p false, jeśli się nie udała, żadna nie trwała
+ *         lub @p live jest równy NULL.
+ */
+bool phfwdLiveWait(PhoneForwardLive *live);
+
+/** @brief Wyznacza przekierowanie numeru.
+ * Działa tak jak @ref phfwdGet dla ostatnio opublikowanej wersji. Nie
+ * czeka na publikujące wątki ani na inne odczyty.
+ * @param[in] live – wskaźnik na tablicę;
+ * @param[in] num  – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+ *         udało się alokować pamięci lub @p live jest równy NULL.
+ */
+PhoneNumbers * phfwdLiveGet(PhoneForwardLive const *live, char const *num);
+
+#endif /* __PHONE_FORWARD_LIVE_H__ */
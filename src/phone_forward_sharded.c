@@ -0,0 +1,338 @@
+/** @file
+ * Implementacja interfejsu phone_forward_sharded.h.
+ *
+ * @author Maria Wysogląd
+ * @date 2022
+ */
+#include <stdalign.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
+#include "phone_forward_sharded.h"
+
+#define SHARD_ALPHABET 12 ///< Liczba różnych cyfr numeru.
+#define SHARD_LINE_SIZE 64 ///< Rozmiar wiersza pamięci podręcznej procesora.
+
+/**
+ * @brief To jest jedna część struktury.
+ * Zajmuje osobny wiersz pamięci podręcznej procesora, więc wątki blokujące
+ * różne części nie unieważniają sobie nawzajem pamięci podręcznej.
+ */
+struct Shard {
+    alignas(SHARD_LINE_SIZE) mtx_t lock; ///< Blokada chroniąca @p pf.
+    PhoneForward *pf; ///< Przekierowania części.
+};
+/**
+ * Tworzy typ Shard.
+ */
+typedef struct Shard Shard;
+
+/**
+ * @brief To jest struktura przechowująca przekierowania podzielone na części.
+ * Przekierowanie prefiksu o pierwszych cyfrach c1, ..., ck, gdzie k to
+ * @p digits, leży w części o numerze c1 * 12^(k-1) + ... + ck. Przy
+ * podziale po dwóch cyfrach przekierowanie jednocyfrowego prefiksu c1 leży
+ * w części o numerze @p long_count + c1. Każde przekierowanie leży więc
+ * w dokładnie jednej części, a jego dodanie blokuje tylko ją.
+ */
+struct PhoneForwardSharded {
+    size_t digits; ///< Liczba cyfr wyznaczających część.
+    size_t long_count; ///< Liczba części prefiksów mających co najmniej @p digits cyfr.
+    size_t count; ///< Liczba utworzonych części.
+    Shard *shards; ///< Tablica części.
+};
+
+/**
+ * @brief Zmienia znak cyfry na odpowiadającą mu liczbę.
+ * @param[in] c - dany znak.
+ * @return Liczba od 0 do 11 lub -1, gdy znak nie jest cyfrą.
+ */
+static int shard_digit(char c) {
+    if ((c >= '0') && (c <= '9')) {
+        return c - '0';
+    }
+    if (c == '*') {
+        return 10;
+    }
+    if (c == '#') {
+        return 11;
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Wyznacza część, w której leżą przekierowania prefiksu.
+ * Sprawdza tylko znaki, które wyznaczają część.
+ * @param[in] pfs - wskaźnik na strukturę;
+ * @param[in] num - wskaźnik na prefiks;
+ * @param[out] index - numer części.
+ * @return Wartość @p false, gdy napis nie zaczyna się od cyfr numeru.
+ */
+static bool shard_of(PhoneForwardSharded const *pfs, char const *num,
+                     size_t *index) {
+    int first = shard_digit(num[0]);
+    if (first < 0) {
+        return false;
+    }
+    if (pfs->digits == 1) {
+        *index = (size_t)first;
+        return true;
+    }
+    if (num[1] == '\0') {
+        *index = pfs->long_count + (size_t)first;
+        return true;
+    }
+
+    int second = shard_digit(num[1]);
+    if (second < 0) {
+        return false;
+    }
+    *index = (size_t)(first * SHARD_ALPHABET + second);
+    return true;
+}
+
+/**
+ * @brief Wyznacza przekierowanie numeru w jednej części.
+ * @param[in, out] shard - wskaźnik na część;
+ * @param[in] num - wskaźnik na numer.
+ * @return Wynik phfwdGet.
+ */
+static PhoneNumbers * shard_get(Shard *shard, char const *num) {
+    mtx_lock(&shard->lock);
+    PhoneNumbers *answer = phfwdGet(shard->pf, num);
+    mtx_unlock(&shard->lock);
+
+    return answer;
+}
+
+PhoneForwardSharded * phfwdShardedNew(size_t digits) {
+    if ((digits != 1) && (digits != 2)) {
+        return NULL;
+    }
+
+    PhoneForwardSharded *pfs = malloc(sizeof(PhoneForwardSharded));
+    if (pfs == NULL) {
+        return NULL;
+    }
+    pfs->digits = digits;
+    pfs->long_count = (digits == 1) ?
+                      SHARD_ALPHABET : SHARD_ALPHABET * SHARD_ALPHABET;
+    size_t total = pfs->long_count + ((digits == 1) ? 0 : SHARD_ALPHABET);
+    pfs->count = 0;
+    // Rozmiar części jest wielokrotnością jej wyrównania.
+    pfs->shards = aligned_alloc(alignof(Shard), total * sizeof(Shard));
+    if (pfs->shards == NULL) {
+        phfwdShardedDelete(pfs);
+        return NULL;
+    }
+
+    while (pfs->count < total) {
+        Shard *shard = &pfs->shards[pfs->count];
+        shard->pf = phfwdNew();
+        if (shard->pf == NULL) {
+            phfwdShardedDelete(pfs);
+            return NULL;
+        }
+        if (mtx_init(&shard->lock, mtx_plain) != thrd_success) {
+            phfwdDelete(shard->pf);
+            phfwdShardedDelete(pfs);
+            return NULL;
+        }
+        pfs->count++;
+    }
+
+    return pfs;
+}
+
+void phfwdShardedDelete(PhoneForwardSharded *pfs) {
+    if (pfs != NULL) {
+        for (size_t i = 0; i < pfs->count; i++) {
+            phfwdDelete(pfs->shards[i].pf);
+            mtx_destroy(&pfs->shards[i].lock);
+        }
+        free(pfs->shards);
+        free(pfs);
+    }
+}
+
+bool phfwdShardedAdd(PhoneForwardSharded *pfs, char const *num1,
+                     char const *num2) {
+    size_t index = 0;
+    if ((pfs == NULL) || (num1 == NULL) || !shard_of(pfs, num1, &index)) {
+        return false;
+    }
+
+    Shard *shard = &pfs->shards[index];
+    mtx_lock(&shard->lock);
+    bool added = phfwdAdd(shard->pf, num1, num2);
+    mtx_unlock(&shard->lock);
+
+    return added;
+}
+
+void phfwdShardedRemove(PhoneForwardSharded *pfs, char const *num) {
+    size_t index = 0;
+    if ((pfs == NULL) || (num == NULL) || !shard_of(pfs, num, &index)) {
+        return;
+    }
+
+    if (index < pfs->long_count) {
+        Shard *shard = &pfs->shards[index];
+        mtx_lock(&shard->lock);
+        phfwdRemove(shard->pf, num);
+        mtx_unlock(&shard->lock);
+        return;
+    }
+
+    /* Jednocyfrowy prefiks dotyczy jego części i wszystkich części
+    o tej samej pierwszej cyfrze. Blokujemy je w kolejności numerów, tak jak
+    każdy wątek, który blokuje naraz kilka części. */
+    size_t first = (index - pfs->long_count) * SHARD_ALPHABET;
+    for (size_t i = first; i < first + SHARD_ALPHABET; i++) {
+        mtx_lock(&pfs->shards[i].lock);
+    }
+    mtx_lock(&pfs->shards[index].lock);
+
+    phfwdRemove(pfs->shards[index].pf, num);
+    for (size_t i = first; i < first + SHARD_ALPHABET; i++) {
+        phfwdRemove(pfs->shards[i].pf, num);
+    }
+
+    mtx_unlock(&pfs->shards[index].lock);
+    for (size_t i = first; i < first + SHARD_ALPHABET; i++) {
+        mtx_unlock(&pfs->shards[i].lock);
+    }
+}
+
+PhoneNumbers * phfwdShardedGet(PhoneForwardSharded const *pfs,
+                               char const *num) {
+    if (pfs == NULL) {
+        return NULL;
+    }
+
+    size_t index = 0;
+    if ((num == NULL) || !shard_of(pfs, num, &index)) {
+        // Napis nie jest numerem, więc każda część da pusty wynik.
+        return shard_get(&pfs->shards[0], num);
+    }
+
+    PhoneNumbers *answer = shard_get(&pfs->shards[index], num);
+    if ((index >= pfs->long_count) || (pfs->digits == 1) ||
+        (answer == NULL)) {
+        return answer;
+    }
+
+    /* Przekierowanie zawsze zmienia numer, więc wynik równy numerowi
+    oznacza, że w jego części żaden prefiks go nie przekierowuje. Może go
+    wtedy przekierowywać jego pierwsza cyfra. */
+    char const *result = phnumGet(answer, 0);
+    if ((result == NULL) || (strcmp(result, num) != 0)) {
+        return answer;
+    }
+    phnumDelete(answer);
+
+    return shard_get(&pfs->shards[pfs->long_count + index / SHARD_ALPHABET],
+                     num);
+}
+
+/**
+ * @brief Scala wyniki phfwdReverse wszystkich części.
+ * @param[in] pfs - wskaźnik na strukturę;
+ * @param[in] num - wskaźnik na numer;
+ * @param[in] keep - funkcja wybierająca numery wyniku lub NULL;
+ * @param[in] context - pierwszy argument funkcji @p keep.
+ * @return Wskaźnik na wynik lub NULL, gdy nie udało się alokować pamięci.
+ */
+static PhoneNumbers * sharded_reverse(PhoneForwardSharded const *pfs,
+                                      char const *num,
+                                      bool (*keep)(void *, char const *),
+                                      void *context) {
+    PhoneNumbers **parts = calloc(pfs->count, sizeof(PhoneNumbers*));
+    if (parts == NULL) {
+        return NULL;
+    }
+
+    bool failed = false;
+    for (size_t i = 0; (i < pfs->count) && !failed; i++) {
+        Shard *shard = &pfs->shards[i];
+        mtx_lock(&shard->lock);
+        parts[i] = phfwdReverse(shard->pf, num);
+        mtx_unlock(&shard->lock);
+        failed = (parts[i] == NULL);
+    }
+
+    // Wyniki części są posortowane, więc scalamy je bez blokad.
+    PhoneNumbers *answer = NULL;
+    if (!failed) {
+        answer = phnumMerge((PhoneNumbers const * const*)parts, pfs->count,
+                            keep, context);
+    }
+    for (size_t i = 0; i < pfs->count; i++) {
+        phnumDelete(parts[i]);
+    }
+    free(parts);
+
+    return answer;
+}
+
+PhoneNumbers * phfwdShardedReverse(PhoneForwardSharded const *pfs,
+                                   char const *num) {
+    if (pfs == NULL) {
+        return NULL;
+    }
+
+    return sharded_reverse(pfs, num, NULL, NULL);
+}
+
+/**
+ * @brief To jest stan sprawdzania wyników phfwdShardedGetReverse.
+ */
+struct ReverseCheck {
+    PhoneForwardSharded const *pfs; ///< Przeszukiwana struktura.
+    char const *num; ///< Numer, na który mają być przekierowywane wyniki.
+    bool failed; ///< Czy nie udało się alokować pamięci.
+};
+/**
+ * Tworzy typ ReverseCheck.
+ */
+typedef struct ReverseCheck ReverseCheck;
+
+/**
+ * @brief Sprawdza, czy numer jest przekierowywany na numer ze stanu.
+ * @param[in, out] context - wskaźnik na stan ReverseCheck;
+ * @param[in] x - wskaźnik na sprawdzany numer.
+ * @return Wartość @p true, jeśli phfwdShardedGet daje dla @p x numer ze
+ *         stanu.
+ */
+static bool forwards_to_num(void *context, char const *x) {
+    ReverseCheck *check = context;
+    PhoneNumbers *result = phfwdShardedGet(check->pfs, x);
+    if (result == NULL) {
+        check->failed = true;
+        return false;
+    }
+
+    char const *y = phnumGet(result, 0);
+    bool equal = (y != NULL) && (strcmp(y, check->num) == 0);
+    phnumDelete(result);
+
+    return equal;
+}
+
+PhoneNumbers * phfwdShardedGetReverse(PhoneForwardSharded const *pfs,
+                                      char const *num) {
+    if (pfs == NULL) {
+        return NULL;
+    }
+
+    ReverseCheck check = {pfs, num, false};
+    PhoneNumbers *answer = sharded_reverse(pfs, num, forwards_to_num, &check);
+    if (check.failed) {
+        phnumDelete(answer);
+        return NULL;
+    }
+
+    return answer;
+}
@@ -0,0 +1,104 @@
+/** @file
+ * Interfejs struktury przekierowań podzielonej na części według początkowych
+ * cyfr numerów
+ *
+ * @author Maria Wysogląd
+ * @date 2022
+ */
+
+#ifndef __PHONE_FORWARD_SHARDED_H__
+#define __PHONE_FORWARD_SHARDED_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "phone_forward.h"
+
+/**
+ * To jest struktura przechowująca przekierowania podzielone na części.
+ * Każda część jest osobną strukturą @ref PhoneForward z własną blokadą
+ * i własnym drzewem odwróconym. Wszystkie funkcje można wywoływać naraz
+ * z wielu wątków, a zmiany przekierowań w różnych częściach nie czekają na
+ * siebie.
+ */
+struct PhoneForwardSharded;
+/**
+ * Tworzy typ PhoneForwardSharded.
+ */
+typedef struct PhoneForwardSharded PhoneForwardSharded;
+
+/** @brief Tworzy nową strukturę podzieloną na części.
+ * Przekierowanie trafia do części wyznaczonej przez pierwsze @p digits cyfr
+ * numeru @p num1. Przy podziale po dwóch cyfrach przekierowania
+ * jednocyfrowych prefiksów trzymamy w osobnych częściach, po jednej na
+ * każdą pierwszą cyfrę.
+ * @param[in] digits – liczba cyfr wyznaczających część: 1 lub 2.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
+ *         alokować pamięci lub @p digits ma inną wartość.
+ */
+PhoneForwardSharded * phfwdShardedNew(size_t digits);
+
+/** @brief Usuwa strukturę.
+ * Nic nie robi, jeśli @p pfs ma wartość NULL. Żaden inny wątek nie może
+ * wtedy korzystać ze struktury.
+ * @param[in] pfs – wskaźnik na usuwaną strukturę.
+ */
+void phfwdShardedDelete(PhoneForwardSharded *pfs);
+
+/** @brief Dodaje przekierowanie.
+ * Działa tak jak @ref phfwdAdd i blokuje tylko część numeru @p num1.
+ * @param[in,out] pfs – wskaźnik na strukturę;
+ * @param[in] num1    – wskaźnik na napis reprezentujący prefiks numerów
+ *                      przekierowywanych;
+ * @param[in] num2    – wskaźnik na napis reprezentujący prefiks numerów,
+ *                      na które jest wykonywane przekierowanie.
+ * @return Wartość @p true, jeśli przekierowanie zostało dodane.
+ *         Wartość @p false w tych samych przypadkach co @ref phfwdAdd.
+ */
+bool phfwdShardedAdd(PhoneForwardSharded *pfs, char const *num1,
+                     char const *num2);
+
+/** @brief Usuwa przekierowania.
+ * Działa tak jak @ref phfwdRemove. Prefiks krótszy od liczby cyfr podziału
+ * dotyczy kilku części, które blokuje wtedy wszystkie naraz.
+ * @param[in,out] pfs – wskaźnik na strukturę;
+ * @param[in] num     – wskaźnik na napis reprezentujący prefiks numerów.
+ */
+void phfwdShardedRemove(PhoneForwardSharded *pfs, char const *num);
+
+/** @brief Wyznacza przekierowanie numeru.
+ * Działa tak jak @ref phfwdGet. Przy podziale po dwóch cyfrach, gdy numeru
+ * nie przekierowuje żaden dłuższy prefiks, sprawdza jeszcze część
+ * przekierowań jednocyfrowych.
+ * @param[in] pfs – wskaźnik na strukturę;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+ *         udało się alokować pamięci lub @p pfs jest równy NULL.
+ */
+PhoneNumbers * phfwdShardedGet(PhoneForwardSharded const *pfs,
+                               char const *num);
+
+/** @brief Wyznacza przekierowania na dany numer.
+ * Działa tak jak @ref phfwdReverse. Numery przekierowywane na @p num mogą
+ * leżeć w dowolnej części, więc pyta kolejno wszystkie części i scala ich
+ * wyniki. Każdą część widzi w innej chwili.
+ * @param[in] pfs – wskaźnik na strukturę;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+ *         udało się alokować pamięci lub @p pfs jest równy NULL.
+ */
+PhoneNumbers * phfwdShardedReverse(PhoneForwardSharded const *pfs,
+                                   char const *num);
+
+/** @brief Wyznacza numery, które są przekierowywane na dany numer.
+ * Działa tak jak @ref phfwdGetReverse: z wyniku @ref phfwdShardedReverse
+ * zostawia numery @p x, dla których @ref phfwdShardedGet daje @p num.
+ * @param[in] pfs – wskaźnik na strukturę;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+ *         udało się alokować pamięci lub @p pfs jest równy NULL.
+ */
+PhoneNumbers * phfwdShardedGetReverse(PhoneForwardSharded const *pfs,
+                                      char const *num);
+
+#endif /* __PHONE_FORWARD_SHARDED_H__ */
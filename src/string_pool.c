@@ -0,0 +1,274 @@
+/** @file
+ * Implementacja interfejsu string_pool.h.
+ *
+ * @author Maria Wysogląd
+ * @date 2022
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "string_pool.h"
+
+/**
+ * @brief Zmienia znak cyfry na jej kod.
+ * @param[in] c - znak cyfry.
+ * @return Kod cyfry od 0 do 11.
+ */
+static unsigned char digit_code(char c) {
+    if (c == '*') {
+        return 10;
+    }
+    else if (c == '#') {
+        return 11;
+    }
+
+    return (unsigned char)(c - '0');
+}
+
+/**
+ * @brief Wyznacza skrót numeru (FNV-1a) po kodach jego cyfr.
+ * @param[in] str - wskaźnik na cyfry numeru;
+ * @param[in] length - liczba cyfr numeru.
+ * @return Skrót numeru.
+ */
+static size_t string_hash(char const *str, size_t length) {
+    uint64_t hash = 14695981039346656037u;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ digit_code(str[i])) * 1099511628211u;
+    }
+
+    return (size_t)hash;
+}
+
+/**
+ * @brief Sprawdza, czy numer z puli jest równy napisowi.
+ * @param[in] entry - wskaźnik na numer z puli;
+ * @param[in] str - wskaźnik na napis;
+ * @param[in] length - długość napisu.
+ * @return Wartość @p true, jeśli numery są równe.
+ */
+static bool string_equal(InternedString const *entry, char const *str,
+                         size_t length) {
+    if (entry->length != length) {
+        return false;
+    }
+
+    for (size_t i = 0; i < length; i++) {
+        if (string_pool_digit(entry, i) != digit_code(str[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Powiększa tablicę mieszającą części dwukrotnie.
+ * @param[in, out] shard - wskaźnik na część puli.
+ * @return Wartość @p true, jeśli udało się alokować pamięć.
+ */
+static bool string_pool_grow(StringShard *shard) {
+    size_t capacity = (shard->capacity == 0) ? 64 : 2 * shard->capacity;
+    InternedString **slots = calloc(capacity, sizeof(InternedString*));
+    if (slots == NULL) {
+        return false;
+    }
+
+    for (size_t i = 0; i < shard->capacity; i++) {
+        if (shard->slots[i] != NULL) {
+            size_t j = shard->slots[i]->hash & (capacity - 1);
+            while (slots[j] != NULL) {
+                j = (j + 1) & (capacity - 1);
+            }
+            slots[j] = shard->slots[i];
+        }
+    }
+
+    free(shard->slots);
+    shard->slots = slots;
+    shard->capacity = capacity;
+
+    return true;
+}
+
+void string_pool_init(StringPool *pool) {
+    for (size_t i = 0; i < STRING_POOL_SHARDS; i++) {
+        pool->shards[i] = (StringShard){NULL, 0, 0};
+    }
+    pool->retire = NULL;
+    pool->retire_context = NULL;
+}
+
+StringPool * string_pool_new(void) {
+    StringPool *pool = malloc(sizeof(StringPool));
+    if (pool != NULL) {
+        string_pool_init(pool);
+    }
+
+    return pool;
+}
+
+void string_pool_delete(StringPool *pool) {
+    if (pool != NULL) {
+        string_pool_destroy(pool);
+        free(pool);
+    }
+}
+
+InternedString const * string_pool_intern(StringPool *pool, char const *str,
+                                          size_t length) {
+    size_t hash = string_hash(str, length);
+    StringShard *shard = &pool->shards[(length == 0) ? 0 : digit_code(str[0])];
+
+    if (shard->capacity != 0) {
+        size_t i = hash & (shard->capacity - 1);
+        while (shard->slots[i] != NULL) {
+            InternedString *entry = shard->slots[i];
+            if ((entry->hash == hash) && string_equal(entry, str, length)) {
+                entry->refs++;
+                return entry;
+            }
+            i = (i + 1) & (shard->capacity - 1);
+        }
+    }
+
+    // Trzymamy zapełnienie tablicy poniżej 3/4.
+    if ((4 * (shard->count + 1) > 3 * shard->capacity) &&
+        !string_pool_grow(shard)) {
+        return NULL;
+    }
+
+    InternedString *entry = malloc(sizeof(InternedString) + PACKED_SIZE(length));
+    if (entry == NULL) {
+        return NULL;
+    }
+    entry->refs = 1;
+    entry->hash = hash;
+    entry->length = length;
+    string_pool_pack(str, length, entry->digits);
+
+    size_t i = hash & (shard->capacity - 1);
+    while (shard->slots[i] != NULL) {
+        i = (i + 1) & (shard->capacity - 1);
+    }
+    shard->slots[i] = entry;
+    shard->count++;
+
+    return entry;
+}
+
+InternedString const * string_pool_retain(InternedString const *str) {
+    ((InternedString*)str)->refs++;
+
+    return str;
+}
+
+void string_pool_release(StringPool *pool, InternedString const *str) {
+    if (str == NULL) {
+        return;
+    }
+
+    InternedString *entry = (InternedString*)str;
+    if (--entry->refs != 0) {
+        return;
+    }
+
+    StringShard *shard =
+        &pool->shards[(str->length == 0) ? 0 : string_pool_digit(str, 0)];
+
+    size_t mask = shard->capacity - 1;
+    size_t i = entry->hash & mask;
+    while (shard->slots[i] != entry) {
+        i = (i + 1) & mask;
+    }
+
+    /* Usuwamy bez znaczników: przesuwamy w zwolnione miejsce kolejne numery
+    z tego samego ciągu próbkowania, które nie stoją na swoim miejscu. */
+    size_t j = i;
+    while (true) {
+        j = (j + 1) & mask;
+        if (shard->slots[j] == NULL) {
+            break;
+        }
+        size_t home = shard->slots[j]->hash & mask;
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            shard->slots[i] = shard->slots[j];
+            i = j;
+        }
+    }
+    shard->slots[i] = NULL;
+    shard->count--;
+
+    if (pool->retire != NULL) {
+        pool->retire(pool->retire_context, entry);
+    }
+    else {
+        free(entry);
+    }
+}
+
+void string_pool_destroy(StringPool *pool) {
+    for (size_t i = 0; i < STRING_POOL_SHARDS; i++) {
+        StringShard *shard = &pool->shards[i];
+        for (size_t j = 0; j < shard->capacity; j++) {
+            free(shard->slots[j]);
+        }
+        free(shard->slots);
+    }
+
+    string_pool_init(pool);
+}
+
+void string_pool_pack(char const *str, size_t length, unsigned char *out) {
+    size_t i = 0;
+    while (i + 1 < length) {
+        out[i / 2] = digit_code(str[i]) | (digit_code(str[i + 1]) << 4);
+        i += 2;
+    }
+
+    if (i < length) {
+        out[i / 2] = digit_code(str[i]);
+    }
+}
+
+void string_pool_unpack(InternedString const *str, char *out) {
+    static char const symbols[] = "0123456789*#";
+    for (size_t i = 0; i < str->length; i++) {
+        out[i] = symbols[string_pool_digit(str, i)];
+    }
+}
+
+bool string_pool_starts_with(InternedString const *str,
+                             unsigned char const *packed, size_t length) {
+    if (length > str->length) {
+        return false;
+    }
+
+    if (memcmp(str->digits, packed, length / 2) != 0) {
+        return false;
+    }
+
+    return ((length % 2) == 0) ||
+           (((str->digits[length / 2] ^ packed[length / 2]) & 0xF) == 0);
+}
+
+int string_pool_compare(InternedString const *str, unsigned char const *packed,
+                        size_t length) {
+    size_t common = (str->length < length) ? str->length : length;
+
+    // Równe bajty pomijamy w całości, różnicę szukamy dopiero w połówkach.
+    size_t i = 0;
+    while ((i + 2 <= common) && (str->digits[i / 2] == packed[i / 2])) {
+        i += 2;
+    }
+    for (; i < common; i++) {
+        int a = string_pool_digit(str, i);
+        int b = (packed[i / 2] >> (4 * (i % 2))) & 0xF;
+        if (a != b) {
+            return a - b;
+        }
+    }
+
+    return (str->length > length) - (str->length < length);
+}
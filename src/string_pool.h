@@ -0,0 +1,172 @@
+/** @file
+ * Interfejs puli współdzielonych napisów numerów
+ *
+ * @author Maria Wysogląd
+ * @date 2022
+ */
+
+#ifndef __STRING_POOL_H__
+#define __STRING_POOL_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Liczba bajtów potrzebnych na zapisanie @p length cyfr po dwie w bajcie.
+ */
+#define PACKED_SIZE(length) (((length) + 1) / 2)
+
+#define STRING_POOL_SHARDS 12 ///< Liczba części puli, po jednej na każdą cyfrę.
+
+/**
+ * @brief To jest numer przechowywany w puli.
+ * Cyfry numeru są zapisane jako kody od 0 do 11 ('*' to 10, '#' to 11), po
+ * dwie w bajcie: cyfra o parzystym numerze w młodszej połowie bajtu,
+ * a o nieparzystym w starszej. Nieużyta połowa ostatniego bajtu jest zerem,
+ * więc równe numery mają równe bajty.
+ */
+struct InternedString {
+    size_t refs; ///< Liczba odwołań do numeru.
+    size_t hash; ///< Skrót numeru.
+    size_t length; ///< Liczba cyfr numeru.
+    unsigned char digits[]; ///< Cyfry numeru zapisane po dwie w bajcie.
+};
+/**
+ * Tworzy typ InternedString.
+ */
+typedef struct InternedString InternedString;
+
+/**
+ * @brief To jest część puli z numerami o tej samej pierwszej cyfrze.
+ * Numery są trzymane w tablicy mieszającej z adresowaniem otwartym
+ * i liniowym próbkowaniem.
+ */
+struct StringShard {
+    InternedString **slots; ///< Tablica mieszająca numerów.
+    size_t capacity; ///< Rozmiar tablicy mieszającej, potęga dwójki lub 0.
+    size_t count; ///< Liczba numerów w części.
+};
+/**
+ * Tworzy typ StringShard.
+ */
+typedef struct StringShard StringShard;
+
+/**
+ * @brief To jest struktura puli napisów.
+ * Każdy różny numer jest przechowywany raz, razem z licznikiem odwołań,
+ * w części wyznaczonej przez swoją pierwszą cyfrę. Wątki, które dodają
+ * i biorą numery o różnych pierwszych cyfrach, nie muszą się więc
+ * synchronizować. Jeśli numery czytają też inne wątki, zwolnienie numeru
+ * usuniętego z puli można odłożyć funkcją @p retire.
+ */
+struct StringPool {
+    StringShard shards[STRING_POOL_SHARDS]; ///< Części puli indeksowane pierwszą cyfrą numeru; pusty numer leży w części 0.
+    void (*retire)(void *context, void *memory); ///< Funkcja odkładająca zwolnienie numeru lub NULL, gdy zwalniamy go od razu.
+    void *retire_context; ///< Pierwszy argument funkcji @p retire.
+};
+/**
+ * Tworzy typ StringPool.
+ */
+typedef struct StringPool StringPool;
+
+/** @brief Inicjalizuje pustą pulę.
+ * Nie alokuje pamięci. Numery usunięte z puli są zwalniane od razu.
+ * @param[out] pool – wskaźnik na inicjalizowaną pulę.
+ */
+void string_pool_init(StringPool *pool);
+
+/** @brief Tworzy pustą pulę na stercie.
+ * @return Wskaźnik na pulę lub NULL, gdy nie udało się alokować pamięci.
+ */
+StringPool * string_pool_new(void);
+
+/** @brief Usuwa pulę utworzoną na stercie.
+ * Zwalnia pulę razem ze wszystkimi numerami. Nic nie robi, jeśli @p pool ma
+ * wartość NULL.
+ * @param[in, out] pool – wskaźnik na pulę utworzoną przez
+ *                        @ref string_pool_new.
+ */
+void string_pool_delete(StringPool *pool);
+
+/** @brief Udostępnia współdzieloną kopię numeru.
+ * Jeśli taki numer jest już w puli, zwiększa jego licznik odwołań,
+ * w przeciwnym razie dodaje do puli jego spakowaną kopię.
+ * @param[in, out] pool – wskaźnik na pulę;
+ * @param[in] str       – wskaźnik na cyfry numeru;
+ * @param[in] length    – liczba cyfr numeru.
+ * @return Wskaźnik na numer w puli, ważny do odpowiadającego wywołania
+ *         @ref string_pool_release, lub NULL, gdy nie udało się alokować
+ *         pamięci.
+ */
+InternedString const * string_pool_intern(StringPool *pool, char const *str,
+                                          size_t length);
+
+/** @brief Bierze dodatkowe odwołanie do numeru.
+ * @param[in] str – wskaźnik na numer z puli.
+ * @return Wskaźnik @p str, ważny do odpowiadającego wywołania
+ *         @ref string_pool_release.
+ */
+InternedString const * string_pool_retain(InternedString const *str);
+
+/** @brief Oddaje odwołanie do numeru.
+ * Zmniejsza licznik odwołań numeru i usuwa go z puli, gdy licznik spadnie
+ * do zera. Pamięć usuniętego numeru oddaje funkcji retire puli, jeśli jest
+ * ustawiona. Nic nie robi, jeśli @p str ma wartość NULL.
+ * @param[in, out] pool – wskaźnik na pulę;
+ * @param[in] str       – wskaźnik na numer zwrócony przez
+ *                        @ref string_pool_intern.
+ */
+void string_pool_release(StringPool *pool, InternedString const *str);
+
+/** @brief Zwalnia całą pulę.
+ * Zwalnia wszystkie numery niezależnie od liczników odwołań.
+ * @param[in, out] pool – wskaźnik na pulę.
+ */
+void string_pool_destroy(StringPool *pool);
+
+/** @brief Pakuje numer po dwie cyfry w bajcie.
+ * @param[in] str    – wskaźnik na cyfry numeru;
+ * @param[in] length – liczba cyfr numeru;
+ * @param[out] out   – tablica na co najmniej PACKED_SIZE(length) bajtów.
+ */
+void string_pool_pack(char const *str, size_t length, unsigned char *out);
+
+/** @brief Wypisuje cyfry numeru jako znaki.
+ * Zapisuje dokładnie str->length znaków, bez kończącego znaku '\0'.
+ * @param[in] str  – wskaźnik na numer z puli;
+ * @param[out] out – tablica na co najmniej str->length znaków.
+ */
+void string_pool_unpack(InternedString const *str, char *out);
+
+/** @brief Udostępnia kod cyfry numeru.
+ * @param[in] str – wskaźnik na numer z puli;
+ * @param[in] i   – numer cyfry, mniejszy od str->length.
+ * @return Kod cyfry od 0 do 11.
+ */
+static inline int string_pool_digit(InternedString const *str, size_t i) {
+    return (str->digits[i / 2] >> (4 * (i % 2))) & 0xF;
+}
+
+/** @brief Sprawdza, czy spakowany napis jest początkiem numeru.
+ * Porównuje całe bajty naraz i tylko ostatnią połowę bajtu osobno.
+ * @param[in] str    – wskaźnik na numer z puli;
+ * @param[in] packed – spakowany napis;
+ * @param[in] length – liczba cyfr spakowanego napisu.
+ * @return Wartość @p true, jeśli numer zaczyna się od danego napisu.
+ */
+bool string_pool_starts_with(InternedString const *str,
+                             unsigned char const *packed, size_t length);
+
+/** @brief Porównuje leksykograficznie numer ze spakowanym napisem.
+ * Cyfry są porównywane według kodów, więc '*' i '#' są większe od '9',
+ * a numer będący początkiem drugiego jest od niego mniejszy.
+ * @param[in] str    – wskaźnik na numer z puli;
+ * @param[in] packed – spakowany napis;
+ * @param[in] length – liczba cyfr spakowanego napisu.
+ * @return Liczba ujemna, zero lub dodatnia, gdy numer jest odpowiednio
+ *         mniejszy, równy lub większy od napisu.
+ */
+int string_pool_compare(InternedString const *str, unsigned char const *packed,
+                        size_t length);
+
+#endif /* __STRING_POOL_H__ */